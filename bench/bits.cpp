@@ -0,0 +1,195 @@
+/*
+ *    SACS, a Simulated Annealing Class Scheduler
+ *    Copyright (C) 2011-2012  Martin Wyngaarden
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+  Micro-benchmark for bit schedule conflict counting.  num_conflicts and the
+  candidate loop of Schedule::get_bitsched are timed using std::bitset<64>, as
+  bs_t used to be, and using bs_t.  The candidate scorers in score.hpp are then
+  timed over the same loop and checked against each other.
+
+  Build from this directory with:
+
+    g++ -O2 -std=c++17 -I../src bits.cpp ../src/score.cpp ../src/utility.cpp -o bits
+*/
+
+#include <bitset>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "score.hpp"
+#include "utility.hpp"
+
+using namespace std;
+
+
+namespace
+{
+const int CANDIDATES  = 35;
+const int INDICES     = 4096;
+const int AVOIDS      = 40;
+const int REPEAT      = 2000;
+
+typedef bitset<64> old_bs_t;
+
+const old_bs_t OLD_MASK_DAY  (MASK_DAY.to_ullong() );
+const old_bs_t OLD_MASK_TIME (MASK_TIME.to_ullong() );
+}
+
+inline int old_num_conflicts (const old_bs_t &bs)
+{
+  return static_cast<int> ( (bs & OLD_MASK_DAY).count() * (bs & OLD_MASK_TIME).count() );
+}
+
+inline int new_num_conflicts (const bs_t &bs)
+{
+  return (bs & MASK_DAY).count() * (bs & MASK_TIME).count();
+}
+
+/*! Returns the best candidate the same way get_bitsched does */
+template <typename T, int (*conflicts) (const T &)>
+int best_candidate (
+  const vector<T>       &vec_cand,
+  const vector<T>       &vec_idx,
+  const vector<int>     &vec_avoid)
+{
+  int best = 0;
+  int best_colls = INF;
+  int colls;
+
+  for (size_t i = 0; i < vec_cand.size(); i++)
+  {
+    colls = 0;
+
+    for (auto it = vec_avoid.begin(); it != vec_avoid.end(); it++)
+      colls += conflicts (vec_idx[*it] & vec_cand[i]);
+
+    if (colls < best_colls)
+    {
+      best_colls = colls;
+      best = static_cast<int> (i);
+    }
+  }
+
+  return best;
+}
+
+template <typename F>
+double time_ns (F f, int n)
+{
+  auto start = chrono::steady_clock::now();
+  f();
+  auto end = chrono::steady_clock::now();
+  return chrono::duration<double, nano> (end - start).count() / n;
+}
+
+int main()
+{
+  util_init();
+
+  int i;
+  int sum = 0;
+
+  prng_t rng;
+  vector<bs_t> vec_cand;
+  vector<bs_t> vec_idx;
+  vector<int> vec_avoid;
+  vector<old_bs_t> vec_old_cand;
+  vector<old_bs_t> vec_old_idx;
+
+  // Candidates are taken from the 3 hour schedules, indices are random
+  for (i = 0; i < CANDIDATES; i++)
+    vec_cand.push_back (sched_bs_idx[3][i % sched_count_idx[3]]);
+
+  for (i = 0; i < INDICES; i++)
+    vec_idx.push_back (bs_t ( (static_cast<uint64_t> (rng() ) << 32 | rng() ) & ~VALID_MASK.to_ullong() ) );
+
+  for (i = 0; i < AVOIDS; i++)
+    vec_avoid.push_back (rng() % INDICES);
+
+  for (i = 0; i < CANDIDATES; i++)
+    vec_old_cand.push_back (old_bs_t (vec_cand[i].to_ullong() ) );
+
+  for (i = 0; i < INDICES; i++)
+    vec_old_idx.push_back (old_bs_t (vec_idx[i].to_ullong() ) );
+
+  double old_nc = time_ns ([&]()
+  {
+    for (int r = 0; r < REPEAT; r++)
+      for (int j = 0; j < INDICES; j++)
+        sum += old_num_conflicts (vec_old_idx[j] & vec_old_cand[j % CANDIDATES]);
+  }, REPEAT * INDICES);
+
+  double new_nc = time_ns ([&]()
+  {
+    for (int r = 0; r < REPEAT; r++)
+      for (int j = 0; j < INDICES; j++)
+        sum += new_num_conflicts (vec_idx[j] & vec_cand[j % CANDIDATES]);
+  }, REPEAT * INDICES);
+
+  double old_gb = time_ns ([&]()
+  {
+    for (int r = 0; r < REPEAT; r++)
+      sum += best_candidate<old_bs_t, old_num_conflicts> (vec_old_cand, vec_old_idx, vec_avoid);
+  }, REPEAT);
+
+  double new_gb = time_ns ([&]()
+  {
+    for (int r = 0; r < REPEAT; r++)
+      sum += best_candidate<bs_t, new_num_conflicts> (vec_cand, vec_idx, vec_avoid);
+  }, REPEAT);
+
+  cout << fixed << setprecision (2)
+       << "popcnt:                  " << (cpu_popcnt ? "yes" : "no") << endl
+       << "num_conflicts bitset:    " << setw (10) << old_nc << " ns" << endl
+       << "num_conflicts bs_t:      " << setw (10) << new_nc << " ns" << endl
+       << "get_bitsched loop bitset:" << setw (10) << old_gb << " ns" << endl
+       << "get_bitsched loop bs_t:  " << setw (10) << new_gb << " ns" << endl
+       << "(checksum " << sum << ")" << endl;
+
+  const char *isa[3] = { "SCALAR", "AVX2", "AVX512" };
+  score_fn_t fn[3] = { add_conflicts_scalar, add_conflicts_avx2, add_conflicts_avx512 };
+  vector<int> vec_expect (CANDIDATES, 0);
+  vector<int> vec_colls (CANDIDATES, 0);
+
+  add_conflicts_scalar (&vec_cand[0], CANDIDATES, &vec_idx[0], &vec_avoid[0], AVOIDS, &vec_expect[0]);
+
+  for (i = 0; i < 3; i++)
+  {
+    if (!score_supported (isa[i]) )
+    {
+      cout << "scorer " << setw (18) << left << isa[i] << "unsupported" << endl;
+      continue;
+    }
+
+    double ns = time_ns ([&]()
+    {
+      for (int r = 0; r < REPEAT; r++)
+      {
+        vec_colls.assign (CANDIDATES, 0);
+        fn[i] (&vec_cand[0], CANDIDATES, &vec_idx[0], &vec_avoid[0], AVOIDS, &vec_colls[0]);
+      }
+    }, REPEAT);
+
+    cout << "scorer " << setw (18) << left << isa[i] << right << setw (10) << ns << " ns"
+         << (vec_colls == vec_expect ? "" : "  MISMATCH") << endl;
+  }
+
+  return 0;
+}
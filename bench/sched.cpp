@@ -0,0 +1,297 @@
+/*
+ *    SACS, a Simulated Annealing Class Scheduler
+ *    Copyright (C) 2011-2012  Martin Wyngaarden
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+  Scheduler benchmark.  A synthetic problem is written to the current directory
+  by write_workload, then the stages of a run are timed separately:
+
+    util_init       precomputing bit schedules
+    parse           reading the CSV files, i.e. constructing Schedule
+    conflict_graph  building the course conflict graph and its statistics
+    get_bitsched    scheduling every course once from the constant courses
+    get_bias        scoring every candidate time of every course
+    perturb_state   one annealing iteration, every perturbed state accepted
+    save_scheds     writing scheduled.csv, failed.csv and the HTML files
+
+  Options are given as OPTION=VALUE arguments.  The workload options and their
+  defaults are SEED=1, SECTIONS=1000, ROOMS=60, INSTRUCTORS=150, GROUPS=40,
+  GROUP-SIZE=8 and AVOID=4.  ITERS=200 sets the number of perturb_state calls
+  and PASSES=10 the number of passes over the courses for get_bitsched and
+  get_bias.  GENERATE=FALSE benchmarks the CSV files already in the directory,
+  and any sched.cfg option, e.g. SIMD=SCALAR, may be given as well.
+
+  Results are written to stdout as CSV, one line per stage, and appended to the
+  file named by OUTPUT if given, so that runs can be compared over time.
+
+  Run from a scratch directory, since the CSV files there are overwritten.
+  Build from this directory with:
+
+    g++ -O2 -std=c++17 -I../src sched.cpp workload.cpp ../src/bias.cpp ../src/course.cpp ../src/debug.cpp ../src/graph.cpp ../src/mapfile.cpp ../src/moves.cpp ../src/outfile.cpp ../src/room.cpp ../src/schedule.cpp ../src/score.cpp ../src/snapshot.cpp ../src/utility.cpp -lpthread -o sched
+*/
+
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "graph.hpp"
+#include "schedule.hpp"
+#include "score.hpp"
+#include "utility.hpp"
+#include "workload.hpp"
+
+using namespace std;
+
+
+namespace
+{
+typedef chrono::steady_clock bench_clock_t;
+
+const string RESULT_HEADER = "timestamp,scorer,seed,sections,rooms,instructors,stage,calls,seconds,ns_per_call";
+
+/*! Returns the seconds elapsed since start */
+double elapsed (const bench_clock_t::time_point &start)
+{
+  return chrono::duration<double> (bench_clock_t::now() - start).count();
+}
+}
+
+int main (int argc, char *argv[])
+{
+  int i, p;
+
+  double secs;
+  string str;
+  string option;
+  string value;
+
+  map<string, string> bench_opts;
+  vector<string> vec_result;
+  ostringstream oss;
+
+  opts_init();
+  prog_opts["OVERWRITE"] = "YES";
+  prog_opts["VERBOSE"]   = "FALSE";
+
+  bench_opts["AVOID"]       = "4";
+  bench_opts["GENERATE"]    = "TRUE";
+  bench_opts["GROUP-SIZE"]  = "8";
+  bench_opts["GROUPS"]      = "40";
+  bench_opts["INSTRUCTORS"] = "150";
+  bench_opts["ITERS"]       = "200";
+  bench_opts["OUTPUT"]      = "";
+  bench_opts["PASSES"]      = "10";
+  bench_opts["ROOMS"]       = "60";
+  bench_opts["SECTIONS"]    = "1000";
+  bench_opts["SEED"]        = "1";
+
+  for (i = 1; i < argc; i++)
+  {
+    str    = argv[i];
+    option = make_upper (get_token (str, 0, "=") );
+    value  = get_token (str, 1, "=");
+
+    if (bench_opts.find (option) != bench_opts.end() )
+      bench_opts[option] = option == "OUTPUT" ? value : make_upper (value);
+
+    else if (prog_opts.find (option) != prog_opts.end() )
+      prog_opts[option] = make_upper (value);
+
+    else
+    {
+      cerr << "Invalid option: " << str << endl;
+      return 1;
+    }
+  }
+
+  workload_t w;
+  w.seed        = static_cast<uint32_t> (strtoul (bench_opts["SEED"].c_str(), NULL, 10) );
+  w.sections    = atoi (bench_opts["SECTIONS"].c_str() );
+  w.rooms       = atoi (bench_opts["ROOMS"].c_str() );
+  w.instructors = atoi (bench_opts["INSTRUCTORS"].c_str() );
+  w.groups      = atoi (bench_opts["GROUPS"].c_str() );
+  w.group_size  = atoi (bench_opts["GROUP-SIZE"].c_str() );
+  w.avoid       = atoi (bench_opts["AVOID"].c_str() );
+
+  int iters  = atoi (bench_opts["ITERS"].c_str() );
+  int passes = atoi (bench_opts["PASSES"].c_str() );
+
+  if (bench_opts["GENERATE"] == "TRUE" && !write_workload (w) )
+  {
+    cerr << "Unable to write workload to the current directory" << endl;
+    return 1;
+  }
+
+  // Stage name and number of calls followed by seconds taken
+  vector<pair<string, int> > vec_stage;
+  vector<double> vec_secs;
+
+  bench_clock_t::time_point start = bench_clock_t::now();
+  util_init();
+  vec_stage.push_back (make_pair ("util_init", 1) );
+  vec_secs.push_back (elapsed (start) );
+
+  start = bench_clock_t::now();
+  Schedule sched;
+  vec_stage.push_back (make_pair ("parse", 1) );
+  vec_secs.push_back (elapsed (start) );
+
+  prng_t rng (w.seed);
+  vector<course_t> vec_crs;
+  vector<slot_t> vec_slot;
+
+  for (auto it = sched.m_mapstr_course.begin(); it != sched.m_mapstr_course.end(); it++)
+  {
+    slot_t slot;
+    slot.time = -1;
+    slot.room = it->second.const_room ? -1 : static_cast<int> (rng() % it->second.vec_prooms.size() );
+    slot.health.init();
+    vec_crs.push_back (it->second);
+    vec_slot.push_back (slot);
+  }
+
+  graph_t graph;
+  graph_stats_t stats;
+  start = bench_clock_t::now();
+  graph_build (graph, vec_crs, CMUL_AVOID, CMUL_ELEC, CMUL_INSTR, CMUL_ROOM);
+  graph_stats (graph, stats);
+  vec_stage.push_back (make_pair ("conflict_graph", 1) );
+  vec_secs.push_back (elapsed (start) );
+
+  // Universal indices holding only the constant courses, as Schedule keeps in m_const_uidx
+  uidx_t base;
+  uidx_t uidx;
+  base.resize (sched.m_sym_crs.size(), sched.m_sym_instr.size(), sched.m_sym_room.size() );
+
+  for (auto it = sched.m_mapstr_const_course.begin(); it != sched.m_mapstr_const_course.end(); it++)
+    base.push (it->second);
+
+  start = bench_clock_t::now();
+
+  for (p = 0; p < passes; p++)
+  {
+    uidx = base;
+
+    for (size_t c = 0; c < vec_crs.size(); c++)
+      sched.get_bitsched (vec_crs[c], vec_slot[c], uidx);
+  }
+
+  vec_stage.push_back (make_pair ("get_bitsched", passes * static_cast<int> (vec_crs.size() ) ) );
+  vec_secs.push_back (elapsed (start) );
+
+  int calls = 0;
+  int bias  = 0;
+  start = bench_clock_t::now();
+
+  for (p = 0; p < passes; p++)
+    for (auto it = vec_crs.begin(); it != vec_crs.end(); it++)
+      for (auto it_bs = it->vec_avail_times.begin(); it_bs != it->vec_avail_times.end(); it_bs++)
+      {
+        for (auto it_instr = it->vec_instr_sym.begin(); it_instr != it->vec_instr_sym.end(); it_instr++, calls++)
+          bias += sched.get_bias (*it_instr, *it_bs);
+
+        bias += sched.get_bias (sched.m_bias_all, *it_bs);
+        calls++;
+      }
+
+  vec_stage.push_back (make_pair ("get_bias", calls) );
+  vec_secs.push_back (elapsed (start) );
+
+  // Keeps the inlined get_bias calls from being optimized away
+  volatile int bias_sink = bias;
+  (void) bias_sink;
+
+  chain_t chain;
+  health_t health;
+  sched.init_chain (chain);
+  chain.rng.seed (w.seed);
+
+  start = bench_clock_t::now();
+
+  for (i = 0; i < iters; i++)
+  {
+    sched.perturb_state (chain.state, health, chain.cur_state, chain.rng, chain.chkpt);
+    chain.cur_state.health = health;
+    chain.cur_state.health.fitness = get_score (health, chain.cur_state.vec_order.size() );
+    sched.accept_state (chain.state, chain.cur_state, chain.chkpt);
+  }
+
+  vec_stage.push_back (make_pair ("perturb_state", iters) );
+  vec_secs.push_back (elapsed (start) );
+
+  // save_scheds reports failed courses to the console
+  streambuf *cout_buf = cout.rdbuf (NULL);
+  start = bench_clock_t::now();
+  sched.save_scheds (chain.state);
+  vec_stage.push_back (make_pair ("save_scheds", 1) );
+  vec_secs.push_back (elapsed (start) );
+  cout.rdbuf (cout_buf);
+
+  str = score_init (prog_opts["SIMD"]);
+
+  for (size_t s = 0; s < vec_stage.size(); s++)
+  {
+    secs = vec_secs[s];
+    oss << time (NULL) << ","
+        << str << ","
+        << w.seed << ","
+        << sched.m_mapstr_course.size() + sched.m_mapstr_const_course.size() << ","
+        << sched.m_mapstr_labrooms.size() + sched.m_mapstr_stdrooms.size() << ","
+        << sched.m_sym_instr.size() << ","
+        << vec_stage[s].first << ","
+        << vec_stage[s].second << ","
+        << fixed << setprecision (6) << secs << ","
+        << setprecision (1) << (vec_stage[s].second ? secs * 1.0e+9 / vec_stage[s].second : 0.0);
+    vec_result.push_back (oss.str() );
+    oss.str ("");
+  }
+
+  cout << RESULT_HEADER << endl;
+
+  for (auto it = vec_result.begin(); it != vec_result.end(); it++)
+    cout << *it << endl;
+
+  if (bench_opts["OUTPUT"] != "")
+  {
+    ifstream check_file (bench_opts["OUTPUT"].c_str() );
+    bool empty = !check_file.is_open() || check_file.peek() == ifstream::traits_type::eof();
+    check_file.close();
+
+    ofstream result_file (bench_opts["OUTPUT"].c_str(), ios::app);
+
+    if (!result_file.is_open() )
+    {
+      cerr << "Unable to open " << bench_opts["OUTPUT"] << endl;
+      return 1;
+    }
+
+    if (empty)
+      result_file << RESULT_HEADER << "\n";
+
+    for (auto it = vec_result.begin(); it != vec_result.end(); it++)
+      result_file << *it << "\n";
+  }
+
+  return 0;
+}
@@ -0,0 +1,224 @@
+/*
+ *    SACS, a Simulated Annealing Class Scheduler
+ *    Copyright (C) 2011-2012  Martin Wyngaarden
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "utility.hpp"
+#include "workload.hpp"
+
+using namespace std;
+
+
+namespace
+{
+const char *DAYS[5] = { "MON", "TUE", "WED", "THU", "FRI" };
+
+const char *STATUS[13] =
+{
+  "AVR6", "AVR5", "AVR4", "AVR3", "AVR2", "AVR1",
+  "PRF1", "PRF2", "PRF3", "PRF4", "PRF5", "PRF6",
+  "VOID"
+};
+
+/*! Returns prefix followed by n padded with zeros to width digits */
+string make_name (const string &prefix, int n, int width)
+{
+  ostringstream oss;
+  oss << prefix << setw (width) << setfill ('0') << n;
+  return oss.str();
+}
+
+/*! Returns a time in [lo, hi) on the half hour */
+double rand_time (prng_t &rng, int lo, int hi)
+{
+  return lo + (rng() % (2 * (hi - lo) ) ) / 2.0;
+}
+
+/*! Returns count distinct names from vec_name other than skip */
+vector<string> pick_names (
+  prng_t                &rng,
+  const vector<string>  &vec_name,
+  int                   count,
+  const string          &skip)
+{
+  vector<string> vec_pick;
+  count = min (count, static_cast<int> (vec_name.size() ) - 1);
+
+  while (static_cast<int> (vec_pick.size() ) < count)
+  {
+    const string &name = vec_name[rng() % vec_name.size()];
+
+    if (name != skip && find (vec_pick.begin(), vec_pick.end(), name) == vec_pick.end() )
+      vec_pick.push_back (name);
+  }
+
+  return vec_pick;
+}
+}
+
+bool write_workload (const workload_t &w)
+{
+  int i, j, k;
+  int max_lab = 0;
+  int max_std = 0;
+  int size;
+
+  double start;
+
+  prng_t rng (w.seed);
+  vector<string> vec_name;
+  vector<int> vec_sections;
+  vector<string> vec_instr;
+  vector<string> vec_stdroom;
+  map<string, vector<string> > mapstr_groups;
+
+  ofstream room_file (FILE_ROOM.c_str() );
+  ofstream group_file (FILE_GROUP.c_str() );
+  ofstream course_file (FILE_COURSE.c_str() );
+  ofstream bias_file (FILE_BIAS.c_str() );
+  ofstream html_file (FILE_HTML.c_str() );
+
+  if (!room_file || !group_file || !course_file || !bias_file || !html_file)
+    return false;
+
+  // Rooms, a quarter of them labs and at least one of each type
+  int rooms = max (2, w.rooms);
+  int labs  = max (1, rooms / 4);
+
+  for (i = 0; i < rooms; i++)
+  {
+    if (i < labs)
+    {
+      size = 12 + rng() % 19;
+      max_lab = max (max_lab, size);
+    }
+    else
+    {
+      size = 15 + rng() % 46;
+      max_std = max (max_std, size);
+      vec_stdroom.push_back (make_name ("R", i, 4) );
+    }
+
+    room_file << make_name ("R", i, 4) << "," << size << "," << (i < labs ? "L" : "S") << "\n";
+  }
+
+  for (i = 0; i < max (1, w.instructors); i++)
+    vec_instr.push_back (make_name ("I", i, 4) );
+
+  // Course names with one to three sections each
+  for (i = 0; i < w.sections; i += vec_sections.back() )
+  {
+    vec_name.push_back (make_name ("C", static_cast<int> (vec_name.size() ), 5) );
+    vec_sections.push_back (min (1 + static_cast<int> (rng() % 3), w.sections - i) );
+  }
+
+  // Groups list core courses and electives, courses list the groups they are core to
+  for (i = 0; i < w.groups && vec_name.size() > 1; i++)
+  {
+    string group = make_name ("G", i, 4);
+    vector<string> vec_core = pick_names (rng, vec_name, max (1, w.group_size), "");
+    vector<string> vec_elec = pick_names (rng, vec_name, max (1, w.group_size / 2), "");
+
+    group_file << group << ",CORE/" << vec_to_str (vec_core) << ",ELEC/" << vec_to_str (vec_elec) << "\n";
+
+    for (auto it = vec_core.begin(); it != vec_core.end(); it++)
+      mapstr_groups[*it].push_back (group);
+  }
+
+  course_file << "Course ID,Course,Hours,Type,Days,Times,Instructor,Room,Students,Lectures,Group,Avoid\n";
+
+  for (i = 0; i < static_cast<int> (vec_name.size() ); i++)
+  {
+    const string &name = vec_name[i];
+    string group = vec_to_str (mapstr_groups[name]);
+    string avoid = vec_to_str (pick_names (rng, vec_name, w.avoid, name) );
+
+    for (j = 1; j <= vec_sections[i]; j++)
+    {
+      string instr = vec_instr[rng() % vec_instr.size()];
+
+      // Team taught
+      if (rng() % 10 == 0)
+        instr += ":" + vec_instr[rng() % vec_instr.size()];
+
+      course_file << name << "-" << j << "," << name << ",";
+
+      // Already scheduled, taken into account for avoidance only
+      if (rng() % 20 == 0)
+      {
+        start = rand_time (rng, 8, 17);
+        course_file << "3,S," << (rng() % 2 ? "MON:WED:FRI," : "TUE:THU,")
+                    << fixed << setprecision (1) << start << "-" << start + 1.0 << ","
+                    << instr << "," << vec_stdroom[rng() % vec_stdroom.size()] << ",,,"
+                    << group << "," << avoid << "\n";
+        continue;
+      }
+
+      // Labs
+      if (rng() % 5 == 0)
+      {
+        course_file << 2 + rng() % 2 << ",L,,," << instr << ",,"
+                    << 8 + rng() % (max_lab - 7) << ",,"
+                    << group << "," << avoid << "\n";
+        continue;
+      }
+
+      k = rng() % 10;
+
+      course_file << (k < 7 ? 3 : k < 9 ? 2 : 1) << ",S,,," << instr << ",,"
+                  << 10 + rng() % (max_std - 9) << ",";
+
+      if (k < 7 && k % 3)
+        course_file << 1 + k % 3;
+
+      course_file << "," << group << "," << avoid << "\n";
+    }
+  }
+
+  // Global blocks as in the sample instructor.csv, then random biases
+  bias_file << "ALL,VOID:SUN:ALL,VOID:SAT:ALL\n"
+            << "ALL,VOID:ALL:0-8,VOID:ALL:21-24\n";
+
+  for (auto it = vec_instr.begin(); it != vec_instr.end(); it++)
+  {
+    if (rng() % 2)
+      continue;
+
+    bias_file << *it;
+
+    for (j = 1 + rng() % 3; j > 0; j--)
+    {
+      start = rand_time (rng, 8, 18);
+      bias_file << "," << STATUS[rng() % 13] << ":" << (rng() % 6 ? DAYS[rng() % 5] : "ALL") << ":"
+                << fixed << setprecision (1) << start << "-" << min (21.0, start + 1 + rng() % 4);
+    }
+
+    bias_file << "\n";
+  }
+
+  html_file << "<!DOCTYPE HTML PUBLIC \"-//W3C//DTD HTML 4.01//EN\" \"http://www.w3.org/TR/html4/strict.dtd\">\n"
+            << "<html>\n<head>\n  <title></title>\n</head>\n";
+
+  return room_file.good() && group_file.good() && course_file.good() && bias_file.good() && html_file.good();
+}
@@ -0,0 +1,54 @@
+/*
+ *    SACS, a Simulated Annealing Class Scheduler
+ *    Copyright (C) 2011-2012  Martin Wyngaarden
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#if !defined(WORKLOAD_HPP)
+#define WORKLOAD_HPP
+
+#include <cstdint>
+
+/*!
+  Describes a synthetic problem.  The same seed and sizes always produce the
+  same files.
+
+    sections:     number of course sections in courses.csv
+    rooms:        number of rooms, about a quarter of them labs
+    instructors:  number of instructors sections are drawn from
+    groups:       number of groups in groups.csv
+    group_size:   number of core courses per group, half as many electives
+    avoid:        length of the explicit avoid list of each section
+*/
+struct workload_t
+{
+  uint32_t seed;
+  int sections;
+  int rooms;
+  int instructors;
+  int groups;
+  int group_size;
+  int avoid;
+};
+
+/*!
+  Writes courses.csv, rooms.csv, groups.csv, instructor.csv and html_header.txt
+  for w to the current directory, overwriting any that exist.  Returns false if
+  a file could not be written.
+*/
+bool write_workload (const workload_t &w);
+
+#endif // !defined(WORKLOAD_HPP)
@@ -20,6 +20,8 @@
 #include <iomanip>
 #include <iostream>
 #include <sstream>
+#include <string_view>
+#include <vector>
 
 #include "bias.hpp"
 #include "debug.hpp"
@@ -29,13 +31,13 @@
 using namespace std;
 
 
-Bias::Bias()
+void Bias::read_bias()
 {
   if (prog_opts["VERBOSE"] == "TRUE")
     cout << setw (36) << left << "Reading instructor preferences... ";
 
   e_bias bias;
-  int i;
+  size_t i;
   int line;
   uint8_t days;
   uint32_t flag;
@@ -43,40 +45,44 @@ Bias::Bias()
   double end_time;
   double start_time;
 
-  string instr;
   string read_str;
   string str;
   string valid_status = "AVR6AVR5AVR4AVR3AVR2AVR1OPENPRF1PRF2PRF3PRF4PRF5PRF6VOID";
 
+  string_view field;
+  string_view instr;
+  string_view read_line;
+  vector<string_view> vec_desc;
+  vector<string_view> vec_field;
+  vector<string_view> vec_time;
+
   ostringstream oss;
 
   size_t found;
   Debug debug;
-  bias_file.open (FILE_BIAS);
-
-  if (!bias_file.is_open() )
+  if (!bias_file.open (input_path (FILE_BIAS) ) )
   {
-    str = "Unable to open " + FILE_BIAS;
+    str = "Unable to open " + input_path (FILE_BIAS);
     debug.push_error (str);
   }
 
   debug.live_or_die();
 
-  for (line = 1, flag = 0; getline (bias_file, read_str); line++, flag = 0)
+  for (line = 1, flag = 0; bias_file.getline (read_line); line++, flag = 0)
   {
-    if (read_str.empty() )
+    if (read_line.empty() )
       continue;
 
-    read_str = make_upper (read_str);
+    split (make_upper (read_line, read_str), ',', vec_field);
 
-    for (i = 1; i < token_count (read_str, ","); i++)
+    for (i = 1; i < vec_field.size(); i++)
     {
-      str = get_token (read_str, i, ",");
-
-      if (str == "")
+      if (vec_field[i] == "")
         continue;
 
-      if (token_count (str, ":") != 3)
+      split (vec_field[i], ':', vec_desc);
+
+      if (vec_desc.size() != 3)
       {
         oss << "Invalid schedule descriptor at line " << line
             << ": invalid format";
@@ -85,10 +91,10 @@ Bias::Bias()
         continue;
       }
 
-      str = get_token (get_token (read_str, i, ","), 0, ":");
-      found = valid_status.find (str);
+      field = vec_desc[0];
+      found = valid_status.find (field);
 
-      if (found == string::npos || found % 4 != 0 || str.size() != 4)
+      if (found == string::npos || found % 4 != 0 || field.size() != 4)
       {
         oss << "Invalid schedule descriptor at line " << line
             << ": invalid status, use AVR[6-1]/PRF[1-6]/VOID";
@@ -98,10 +104,10 @@ Bias::Bias()
       }
 
       bias = e_bias (found / 4);
-      str = get_token (get_token (read_str, i, ","), 1, ":");
-      found = VALID_DAYS.find (str);
+      field = vec_desc[1];
+      found = VALID_DAYS.find (field);
 
-      if (found == string::npos || found % 3 != 0 || str.size() != 3)
+      if (found == string::npos || found % 3 != 0 || field.size() != 3)
       {
         oss << "Invalid schedule descriptor at line " << line
             << ": invalid day, use ALL/SUN/MON/TUE/WED/THU/FRI/SAT";
@@ -110,12 +116,12 @@ Bias::Bias()
         continue;
       }
 
-      days = str == "ALL" ? 127 : day_to_flag (str);
-      str = get_token (get_token (read_str, i, ","), 2, ":");
+      days = field == "ALL" ? 127 : day_to_flag (string (field) );
+      field = vec_desc[2];
+      split (field, '-', vec_time);
 
-      if (str != "ALL" &&
-          (token_count (str, "-") != 2 || get_token (str, 0, "-") == "" ||
-           get_token (str, 1, "-") == "") )
+      if (field != "ALL" &&
+          (vec_time.size() != 2 || vec_time[0] == "" || vec_time[1] == "") )
       {
         oss << "Invalid schedule descriptor at line " << line
             << ": invalid time";
@@ -124,9 +130,9 @@ Bias::Bias()
         continue;
       }
 
-      start_time = str == "ALL" ?  0.0 : atof (get_token (str, 0, "-").c_str() );
-      end_time   = str == "ALL" ? 24.0 : atof (get_token (str, 1, "-").c_str() );
-      instr = get_token (read_str, 0, ",");
+      start_time = field == "ALL" ?  0.0 : field_to_double (vec_time[0]);
+      end_time   = field == "ALL" ? 24.0 : field_to_double (vec_time[1]);
+      instr = vec_field[0];
 
       if (instr == "")
       {
@@ -144,6 +150,8 @@ Bias::Bias()
   bias_file.close();
   debug.live_or_die();
 
+  compile_bias();
+
   if (prog_opts["VERBOSE"] == "TRUE")
     cout << "done" << endl;
 }
@@ -161,10 +169,12 @@ int Bias::get_bias (
   assert (end_time <= 24.0);
   assert (days);
 
-  if (m_mapstr_bias.find (instr) == m_mapstr_bias.end() )
+  int sym = m_sym_instr.find (instr);
+
+  if (sym < 0 || sym >= m_bias_rows)
     return 0;
 
-  e_bias bias;
+  int bias;
   int idx;
   int level = 0;
 
@@ -172,7 +182,7 @@ int Bias::get_bias (
     for (int j = 0; j < 2 * (end_time - start_time); j++)
     {
       idx = static_cast<int> (vec_bitpos_idx[days][i] + 2 * start_time + j);
-      bias = m_mapstr_bias[instr][idx];
+      bias = m_vec_bias[336 * sym + idx];
 
       if (bias == VOID)
         return SCORE_VOID;
@@ -186,26 +196,11 @@ int Bias::get_bias (
 int Bias::get_bias (const string &instr, const bs_t &bs)
 {
   assert (instr != "");
-  assert ( (bs & MASK_DAY).any() );
-  assert ( (bs & MASK_TIME).any() );
-  assert ( (bs & VALID_MASK).none() );
-
-  if (m_mapstr_bias.find (instr) == m_mapstr_bias.end() )
-    return 0;
-
-  uint8_t days;
-  double start_time;
-  bs_t bit_sched;
-
-  days       = static_cast<uint8_t> ( (bs >> 56).to_ulong() );
-  bit_sched  = (bs & MASK_TIME) >> 16;
-  start_time = 8 + 0.5 * get_firstbitpos (bit_sched);
-
-  return get_bias (instr, start_time, start_time + bit_sched.count() * 0.5, days);
+  return get_bias (m_sym_instr.find (instr), bs);
 }
 
 void Bias::set_bias (
-  const string &instr,
+  string_view instr,
   double start_time,
   double end_time,
   uint8_t days,
@@ -219,14 +214,43 @@ void Bias::set_bias (
   assert (days);
 
   int idx;
+  int sym = m_sym_instr.intern (instr);
 
-  if (m_mapstr_bias.find (instr) == m_mapstr_bias.end() )
-    m_mapstr_bias[instr].resize (336, OPEN);
+  if (sym >= m_bias_rows)
+  {
+    m_bias_rows = sym + 1;
+    m_vec_bias.resize (336 * m_bias_rows, OPEN);
+  }
 
   for (int i = 0; i < vec_bitpos_idx[days].size(); i++)
     for (int j = 0; j < 2 * (end_time - start_time); j++)
     {
       idx = static_cast<int> (vec_bitpos_idx[days][i] + 2 * start_time + j);
-      m_mapstr_bias[instr][idx] = bias;
+      m_vec_bias[336 * sym + idx] = static_cast<int8_t> (bias);
+    }
+}
+
+void Bias::compile_bias()
+{
+  int d, h;
+  int8_t bias;
+
+  m_vec_bias_sum.assign (7 * 49 * m_bias_rows, 0);
+  m_vec_void.assign (7 * m_bias_rows, 0);
+  m_bias_all = m_sym_instr.find ("ALL");
+
+  for (int r = 0; r < m_bias_rows; r++)
+    for (d = 0; d < 7; d++)
+    {
+      int16_t *sum = &m_vec_bias_sum[49 * (7 * r + d)];
+
+      for (h = 0; h < 48; h++)
+      {
+        bias = m_vec_bias[336 * r + 48 * d + h];
+        sum[h + 1] = static_cast<int16_t> (sum[h] + bias);
+
+        if (bias == VOID)
+          m_vec_void[7 * r + d] |= 1ULL << h;
+      }
     }
 }
@@ -20,11 +20,13 @@
 #if !defined(BIAS_HPP)
 #define BIAS_HPP
 
-#include <fstream>
-#include <map>
+#include <cassert>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "debug.hpp"
+#include "mapfile.hpp"
 #include "utility.hpp"
 
 /*!
@@ -49,9 +51,13 @@
   If the instructor does not have a listing, 0 is returned.  For evaluating
   schedules, this score should be maximized.
 
-  m_mapstr_bias uses a 7*48 sized vector to index preferences, aversions, and
-  blocks.  The zeroth element is Sunday at 00:00 hours, the first 00:30, the
-  48th element is therefore Monday at 00:00 hours.
+  Instructors are interned in m_sym_instr and the ones listed in the bias CSV
+  are given the first m_bias_rows symbols.  Each has 7*48 entries in
+  m_vec_bias to index preferences, aversions, and blocks.  The zeroth element
+  is Sunday at 00:00 hours, the first 00:30, the 48th element is therefore
+  Monday at 00:00 hours.  Once the CSV is read, compile_bias builds prefix sums
+  of the levels and VOID masks for every day, so that scoring a bs_t takes one
+  subtraction and one AND per day.
 
   Private members are for maintaining the bias scores for all relevant
   instructors and for referencing the bias CSV.
@@ -59,12 +65,14 @@
 class Bias
 {
 public:
+  Bias() : m_bias_all (-1), m_bias_rows (0) {};
+
   /*!
-    The constructor does all the work by reading the CSV contents and setting
-    the instructor preferences, aversions, and blocks.  If the CSV contains an
-    error, then the program will exit after writing the error(s) to debug.log.
+    Reads the CSV contents and sets the instructor preferences, aversions, and
+    blocks.  If the CSV contains an error, then the program will exit after
+    writing the error(s) to debug.log.
   */
-  Bias();
+  void read_bias();
 
   /*!
     Used to return a bias score using the instructor's name and a bitsched
@@ -72,6 +80,44 @@ public:
   */
   int get_bias (const std::string &instr, const bs_t &bs);
 
+  /*!
+    Same as above using the interned instructor.  Instructors without a listing
+    in the bias CSV, or instr < 0, return 0.
+  */
+  int get_bias (int instr, const bs_t &bs) const
+  {
+    assert ( (bs & MASK_DAY).any() );
+    assert ( (bs & MASK_TIME).any() );
+    assert ( (bs & VALID_MASK).none() );
+
+    if (instr < 0 || instr >= m_bias_rows)
+      return 0;
+
+    // Time bits of a bitsched are numbered by half hour of the day
+    uint64_t time  = (bs & MASK_TIME).to_ullong();
+    uint32_t days  = static_cast<uint32_t> ( (bs >> 56).to_ulong() );
+    int start      = trailing_zeros (time);
+    int end        = start + popcount (time);
+    int level      = 0;
+    int d;
+
+    const uint64_t *void_mask = &m_vec_void[7 * instr];
+    const int16_t *sum = &m_vec_bias_sum[7 * 49 * instr];
+
+    while (days)
+    {
+      d = trailing_zeros (days);
+      days &= days - 1;
+
+      if (void_mask[d] & time)
+        return SCORE_VOID;
+
+      level += sum[49 * d + end] - sum[49 * d + start];
+    }
+
+    return level;
+  };
+
   /*!
     Used for returning a bias score when a bitsched is not available. days is
     an 8-bit flag using the same format as the high end 8-bits of a bitsched.
@@ -84,18 +130,36 @@ public:
 
   /*! See utility.hpp for more information on e_bias */
   void set_bias (
-    const std::string &instr,
+    std::string_view instr,
     double start_time,
     double end_time,
     uint8_t days,
     e_bias bias);
 
-private:
-  /*! Bias scores for the relevant instructors */
-  std::map<std::string, std::vector<e_bias> > m_mapstr_bias;
+  /*! Interned instructors, those in the bias CSV first */
+  symtab_t m_sym_instr;
+
+  /*! Interned ALL, -1 if there are no global blocks */
+  int m_bias_all;
+
+protected:
+  /*! Called by read_bias to build m_vec_bias_sum and m_vec_void */
+  void compile_bias();
+
+  /*! Number of instructors with bias scores */
+  int m_bias_rows;
+
+  /*! Bias scores, 336 per instructor, e_bias values */
+  std::vector<int8_t> m_vec_bias;
+
+  /*! Prefix sums of the bias scores, 49 per day for each instructor */
+  std::vector<int16_t> m_vec_bias_sum;
+
+  /*! VOID blocks, one mask per day for each instructor, bit n is half hour n */
+  std::vector<uint64_t> m_vec_void;
 
   /*! For referencing the bias CSV file */
-  std::ifstream bias_file;
+  mapfile_t bias_file;
 };
 
 #endif // !defined(BIAS_HPP)
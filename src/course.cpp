@@ -17,9 +17,13 @@
  */
 
 #include <algorithm>
+#include <cstdlib>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
 #include <vector>
 
 #include "course.hpp"
@@ -30,48 +34,112 @@
 using namespace std;
 
 
-Course::Course() : Bias(), Room()
+namespace
 {
-  int i, j;
+/*! Removes repeated courses from each group, keeping the first of each */
+void unique_groups (group_map_t &mapstr_group)
+{
+  unordered_set<string_view> set_seen;
+
+  for (auto it = mapstr_group.begin(); it != mapstr_group.end(); it++)
+  {
+    vector<string> &vec_group = it->second;
+    vector<string> vec_unique;
+
+    set_seen.clear();
+
+    for (auto it_crs = vec_group.begin(); it_crs != vec_group.end(); it_crs++)
+      if (set_seen.insert (*it_crs).second)
+        vec_unique.push_back (*it_crs);
+
+    vec_group.swap (vec_unique);
+  }
+}
+
+/*!
+  Appends to vec_crs the courses of the groups in vec_group found in
+  mapstr_group, except name and those already in vec_crs, in the order they
+  are first found
+*/
+void merge_groups (
+  vector<string>                        &vec_crs,
+  const vector<string_view>             &vec_group,
+  const group_map_t                     &mapstr_group,
+  const string                          &name)
+{
+  // Reused from course to course by each thread
+  static thread_local unordered_set<string_view> set_seen;
+  static thread_local vector<const string *> vec_add;
+
+  set_seen.clear();
+  vec_add.clear();
+
+  // Views into vec_crs stay valid as nothing is added to it until the end
+  set_seen.insert (name);
+
+  for (auto it = vec_crs.begin(); it != vec_crs.end(); it++)
+    set_seen.insert (*it);
+
+  for (auto it = vec_group.begin(); it != vec_group.end(); it++)
+  {
+    auto it_group = mapstr_group.find (*it);
+
+    if (it_group == mapstr_group.end() )
+      continue;
+
+    for (auto it_crs = it_group->second.begin(); it_crs != it_group->second.end(); it_crs++)
+      if (set_seen.insert (*it_crs).second)
+        vec_add.push_back (&*it_crs);
+  }
+
+  vec_crs.reserve (vec_crs.size() + vec_add.size() );
+
+  for (auto it = vec_add.begin(); it != vec_add.end(); it++)
+    vec_crs.push_back (**it);
+}
+}
+
+
+void Course::read_csv()
+{
+  size_t i, j;
   int line;
 
   bool core;
 
-  size_t found;
-
-  string avoid;
-  string instr;
   string read_str;
-  string room_type;
   string str;
-  string str_util;
 
-  uint32_t flag;
-  course_t course;
+  string_view read_line;
+  vector<string_view> vec_field;
+  vector<string_view> vec_name;
+  vector<string_view> vec_part;
+
   stringstream oss;
   Debug debug;
 
+  read_bias();
+  read_rooms();
+
   if (prog_opts["VERBOSE"] == "TRUE")
     cout << setw (36) << left << "Reading group descriptions... ";
 
-  group_file.open (FILE_GROUP);
-
-  if (!group_file.is_open() )
+  if (!group_file.open (input_path (FILE_GROUP) ) )
   {
-    str = "Unable to open " + FILE_GROUP;
+    str = "Unable to open " + input_path (FILE_GROUP);
     debug.push_error (str);
   }
 
   debug.live_or_die();
 
-  for (line = 1, flag = 0; getline (group_file, read_str); line++, flag = 0)
+  for (line = 1; group_file.getline (read_line); line++)
   {
-    if (read_str.empty() )
+    if (read_line.empty() )
       continue;
 
-    read_str = make_upper (read_str);
+    split (make_upper (read_line, read_str), ',', vec_field);
 
-    if (token_count (read_str, ",") < 2)
+    if (vec_field.size() < 2)
     {
       oss << "Invalid group description at line " << line
           << ": invalid format";
@@ -80,12 +148,13 @@ Course::Course() : Bias(), Room()
       continue;
     }
 
-    for (i = 1; i < token_count (read_str, ","); i++)
+    for (i = 1; i < vec_field.size(); i++)
     {
-      str = get_token (read_str, i, ",");
+      split (vec_field[i], '/', vec_part);
+      split (get_field (vec_part, 1), ':', vec_name);
 
-      if ( (get_token (str, 0, "/") != "CORE" && get_token (str, 0, "/") != "ELEC")
-           || (token_count (get_token (str, 1, "/"), ":") < 1) )
+      if ( (get_field (vec_part, 0) != "CORE" && get_field (vec_part, 0) != "ELEC")
+           || (vec_name.size() < 1) )
       {
         oss << "Invalid group description at line " << line
             << ": invalid format, use CORE or ELEC";
@@ -94,23 +163,19 @@ Course::Course() : Bias(), Room()
         continue;
       }
 
-      core = get_token (str, 0, "/") == "CORE";
-      str = get_token (str, 1, "/");
-
-      for (j = 0; j < token_count (str, ":"); j++)
-      {
-        if (core)
-          m_mapstr_core[get_token (read_str, 0, ",") ].push_back (get_token (str, j, ":") );
-
-        else
-          m_mapstr_elec[get_token (read_str, 0, ",") ].push_back (get_token (str, j, ":") );
+      core = vec_part[0] == "CORE";
+      vector<string> &vec_group = core ? m_mapstr_core[string (vec_field[0])] : m_mapstr_elec[string (vec_field[0])];
 
-      }
+      for (j = 0; j < vec_name.size(); j++)
+        vec_group.push_back (string (vec_name[j]) );
     }
   }
 
   group_file.close();
 
+  unique_groups (m_mapstr_core);
+  unique_groups (m_mapstr_elec);
+
   if (prog_opts["VERBOSE"] == "TRUE")
     cout << "done" << endl;
 
@@ -119,238 +184,315 @@ Course::Course() : Bias(), Room()
   if (prog_opts["VERBOSE"] == "TRUE")
     cout << setw (36) << left << "Reading course descriptions... ";
 
-  course_file.open (FILE_COURSE);
-
-  if (!course_file.is_open() )
+  if (!course_file.open (input_path (FILE_COURSE) ) )
   {
-    str = "Unable to open " + FILE_COURSE;
+    str = "Unable to open " + input_path (FILE_COURSE);
     debug.push_error (str);
   }
 
   debug.live_or_die();
 
-  for (line = 1, flag = 0; getline (course_file, read_str); line++, flag = 0)
-  {
-    if (read_str.empty() )
-      continue;
+  // Lines are numbered from 1, empty lines included
+  vector<string_view> vec_read;
 
-    read_str = make_upper (read_str);
+  while (course_file.getline (read_line) )
+    vec_read.push_back (read_line);
 
-    if (line == 1)
-    {
-      if (get_token (read_str, 0, ",") != "COURSE ID")
-        debug.push_error ("Invalid file format: courses.csv");
+  m_contiguous_labs = prog_opts["CONTIGUOUS-LABS"] == "TRUE";
+  m_lab_start       = atoi (prog_opts["LAB-START-TIME"].c_str() );
+  m_lab_end         = atoi (prog_opts["LAB-END-TIME"].c_str() );
 
-      continue;
-    }
+  int lines   = static_cast<int> (vec_read.size() );
+  int threads = atoi (prog_opts["THREADS"].c_str() );
+
+  if (threads < 1)
+    threads = max (1, static_cast<int> (thread::hardware_concurrency() ) );
+
+  threads = max (1, min (threads, lines / COURSE_CHUNK) );
 
-    if (token_count (read_str, ",") < COURSE_TOKENS)
+  /*
+    Each thread parses and expands a run of lines.  The courses are then saved
+    in the order of their lines, so duplicates and errors are found the same
+    whatever the number of threads.
+  */
+  vector<crs_line_t> vec_line (lines);
+  vector<thread> vec_thread;
+
+  for (int t = 0; t < threads; t++)
+    vec_thread.push_back (thread (&Course::parse_thread, this, ref (vec_line), cref (vec_read),
+                                  lines * t / threads, lines * (t + 1) / threads) );
+
+  for (auto it = vec_thread.begin(); it != vec_thread.end(); it++)
+    it->join();
+
+  for (auto it = vec_line.begin(); it != vec_line.end(); it++)
+  {
+    for (auto it_err = it->vec_error.begin(); it_err != it->vec_error.end(); it_err++)
+      debug.push_error (*it_err);
+
+    if ( (it->kind == CRS_CONST  && push_const_course (it->course) ) ||
+         (it->kind == CRS_COURSE && push_course (it->course, it->vec_room_error) ) )
     {
-      oss << "Invalid course description at line " << line
-          << ": invalid format";
+      oss << "Invalid course description at line " << it->line
+          << ": duplicate";
       debug.push_error (oss.str() );
       oss.str ("");
-      continue;
     }
+  }
 
-    if (get_token (read_str, 0, ",") == "")
-      continue;
+  course_file.close();
 
-    course.reset();
+  if (prog_opts["VERBOSE"] == "TRUE")
+    cout << "done" << endl;
 
-    if ( (course.id = get_token (read_str, 0, ",") ) != "")
-      flag |= COURSE_ID;
+  debug.live_or_die();
+}
 
-    if ( (course.name = get_token (read_str, 1, ",") ) != "")
-      flag |= COURSE_NAME;
+void Course::parse_thread (
+  vector<crs_line_t>          &vec_line,
+  const vector<string_view>   &vec_read,
+  int                         first,
+  int                         last)
+{
+  for (int i = first; i < last; i++)
+  {
+    parse_course (vec_read[i], i + 1, vec_line[i]);
 
-    if ( (room_type = get_token (read_str, 3, ",") ) != "")
-      flag |= COURSE_TYPE;
+    if (vec_line[i].kind == CRS_COURSE)
+      expand_course (vec_line[i].course, vec_line[i].vec_room_error);
+  }
+}
 
-    if ( (instr = get_token (read_str, 6, ",") ) != "")
-      flag |= COURSE_INSTR;
+void Course::parse_course (string_view read_line, int line, crs_line_t &crs_line)
+{
+  // Reused from line to line by each thread
+  static thread_local string read_str;
+  static thread_local vector<string_view> vec_field;
+  static thread_local vector<string_view> vec_name;
+  static thread_local vector<string_view> vec_part;
 
-    if ( (course.room_id = get_token (read_str, 7, ",") ) != "")
-      flag |= COURSE_ROOM;
+  size_t i, j;
+  size_t found;
 
-    if ( (course.group = get_token (read_str, 10, ",") ) != "")
-      flag |= COURSE_GROUP;
+  string avoid;
+  string instr;
+  string room_type;
+  string str_util;
+  string_view field;
 
-    if ( (avoid = get_token (read_str, 11, ",") ) != "")
-      flag |= COURSE_AVOID;
+  uint32_t flag = 0;
+  course_t &course = crs_line.course;
+  ostringstream oss;
 
-    str = get_token (read_str, 2, ",");
+  crs_line.line = line;
+  crs_line.kind = CRS_NONE;
 
-    if (str != "")
-    {
-      course.hours = atoi (str.c_str() );
-      flag |= COURSE_HOURS;
-    }
+  if (read_line.empty() )
+    return;
 
-    str = get_token (read_str, 4, ",");
+  split (make_upper (read_line, read_str), ',', vec_field);
 
-    if (str != "")
-    {
-      if (token_count (str, "/") > 1)
-      {
-        course.multi_days = true;
-        course.vec_days.resize (token_count (str, "/"), 0);
-      }
+  if (line == 1)
+  {
+    if (get_field (vec_field, 0) != "COURSE ID")
+      crs_line.vec_error.push_back ("Invalid file format: courses.csv");
 
-      for (j = 0; j < token_count (str, "/"); j++)
-      {
-        for (i = 0; i < token_count (get_token (str, j, "/"), ":"); i++)
-        {
-          str_util = get_token (get_token (str, j, "/"), i, ":");
-          found = VALID_DAYS.find (str_util);
-
-          if (found == string::npos || found % 3 != 0 || str_util.size() != 3)
-          {
-            oss << "Invalid course days at line " << line
-                << ": invalid format";
-            debug.push_error (oss.str() );
-            oss.str ("");
-            continue;
-          }
-
-          if (course.multi_days)
-            course.vec_days[j] |= day_to_flag (str_util);
-
-          else
-            course.days |= day_to_flag (str_util);
-        }
-      }
+    return;
+  }
 
-      flag |= COURSE_DAYS;
-      course.const_days = true;
-    }
+  if (vec_field.size() < COURSE_TOKENS)
+  {
+    oss << "Invalid course description at line " << line
+        << ": invalid format";
+    crs_line.vec_error.push_back (oss.str() );
+    return;
+  }
 
-    str = get_token (read_str, 5, ",");
+  if (vec_field[0] == "")
+    return;
 
-    if (token_count (str, "-") == 2)
-    {
-      course.start_time = atof (get_token (str, 0, "-").c_str() );
-      course.end_time = atof (get_token (str, 1, "-").c_str() );
-      flag |= COURSE_TIMES;
-      course.const_time = true;
-    }
+  course.reset();
 
-    str = get_token (read_str, 8, ",");
+  if ( (course.id = vec_field[0]) != "")
+    flag |= COURSE_ID;
 
-    if (str != "")
-    {
-      course.size = atoi (str.c_str() );
-      flag |= COURSE_SIZE;
-    }
+  if ( (course.name = vec_field[1]) != "")
+    flag |= COURSE_NAME;
 
-    str = get_token (read_str, 9, ",");
+  if ( (room_type = vec_field[3]) != "")
+    flag |= COURSE_TYPE;
 
-    if (str != "")
-    {
-      course.lectures = atoi (str.c_str() );
-      flag |= COURSE_LECTS;
-    }
+  if ( (instr = vec_field[6]) != "")
+    flag |= COURSE_INSTR;
 
-    if ( (COURSE_ID|COURSE_NAME) & ~flag ||
-         (COURSE_TYPE & flag && room_type != "L" && room_type != "S") )
-    {
-      oss << "Invalid course description at line " << line
-          << ": invalid course name, ID, or class type";
-      debug.push_error (oss.str() );
-      oss.str ("");
-      continue;
-    }
+  if ( (course.room_id = vec_field[7]) != "")
+    flag |= COURSE_ROOM;
 
-    course.is_lab     = room_type      == "S" ? false : true;
-    course.const_room = course.room_id ==  "" ? false : true;
+  if ( (course.group = vec_field[10]) != "")
+    flag |= COURSE_GROUP;
 
-    for (i = 0; i < token_count (avoid, ":"); i++)
-      course.vec_avoid.push_back (get_token (avoid, i, ":") );
+  if ( (avoid = vec_field[11]) != "")
+    flag |= COURSE_AVOID;
 
-    for (i = 0; i < token_count (instr, ":"); i++)
-      course.vec_instr.push_back (get_token (instr, i, ":") );
+  field = vec_field[2];
 
-    if ( (! ( (COURSE_TIMES|COURSE_DAYS) & ~flag) && !course.size) ||
-         ! ( (COURSE_TIMES|COURSE_DAYS|COURSE_ROOM) & ~flag) )
+  if (field != "")
+  {
+    course.hours = field_to_int (field);
+    flag |= COURSE_HOURS;
+  }
+
+  field = vec_field[4];
+
+  if (field != "")
+  {
+    split (field, '/', vec_part);
+
+    if (vec_part.size() > 1)
     {
-      if (push_const_course (course) )
-      {
-        oss << "Invalid course description at line " << line
-            << ": duplicate";
-        debug.push_error (oss.str() );
-        oss.str ("");
-      }
+      course.multi_days = true;
+      course.vec_days.resize (vec_part.size(), 0);
     }
-    else if (! ( (COURSE_HOURS|COURSE_TYPE|COURSE_INSTR|COURSE_SIZE) & ~flag) )
+
+    for (j = 0; j < vec_part.size(); j++)
     {
-      if (push_course (course) )
+      split (vec_part[j], ':', vec_name);
+
+      for (i = 0; i < vec_name.size(); i++)
       {
-        oss << "Invalid course description at line " << line
-            << ": duplicate";
-        debug.push_error (oss.str() );
-        oss.str ("");
+        str_util = vec_name[i];
+        found = VALID_DAYS.find (str_util);
+
+        if (found == string::npos || found % 3 != 0 || str_util.size() != 3)
+        {
+          oss << "Invalid course days at line " << line
+              << ": invalid format";
+          crs_line.vec_error.push_back (oss.str() );
+          oss.str ("");
+          continue;
+        }
+
+        if (course.multi_days)
+          course.vec_days[j] |= day_to_flag (str_util);
+
+        else
+          course.days |= day_to_flag (str_util);
       }
     }
-    else
-    {
-      oss << "Invalid course description at line " << line
-          << ": invalid format";
-      debug.push_error (oss.str() );
-      oss.str ("");
-    }
+
+    flag |= COURSE_DAYS;
+    course.const_days = true;
   }
 
-  course_file.close();
+  split (vec_field[5], '-', vec_part);
 
-  if (prog_opts["VERBOSE"] == "TRUE")
-    cout << "done" << endl;
+  if (vec_part.size() == 2)
+  {
+    course.start_time = field_to_double (vec_part[0]);
+    course.end_time = field_to_double (vec_part[1]);
+    flag |= COURSE_TIMES;
+    course.const_time = true;
+  }
 
-  debug.live_or_die();
+  field = vec_field[8];
+
+  if (field != "")
+  {
+    course.size = field_to_int (field);
+    flag |= COURSE_SIZE;
+  }
+
+  field = vec_field[9];
+
+  if (field != "")
+  {
+    course.lectures = field_to_int (field);
+    flag |= COURSE_LECTS;
+  }
+
+  if ( (COURSE_ID|COURSE_NAME) & ~flag ||
+       (COURSE_TYPE & flag && room_type != "L" && room_type != "S") )
+  {
+    oss << "Invalid course description at line " << line
+        << ": invalid course name, ID, or class type";
+    crs_line.vec_error.push_back (oss.str() );
+    return;
+  }
+
+  course.is_lab     = room_type      == "S" ? false : true;
+  course.const_room = course.room_id ==  "" ? false : true;
+
+  split (avoid, ':', vec_name);
+
+  // A name listed twice would count its collisions twice
+  for (i = 0; i < vec_name.size(); i++)
+    if (find (course.vec_avoid.begin(), course.vec_avoid.end(), vec_name[i]) == course.vec_avoid.end() )
+      course.vec_avoid.push_back (string (vec_name[i]) );
+
+  split (instr, ':', vec_name);
+
+  for (i = 0; i < vec_name.size(); i++)
+    course.vec_instr.push_back (string (vec_name[i]) );
+
+  if ( (! ( (COURSE_TIMES|COURSE_DAYS) & ~flag) && !course.size) ||
+       ! ( (COURSE_TIMES|COURSE_DAYS|COURSE_ROOM) & ~flag) )
+  {
+    crs_line.kind = CRS_CONST;
+  }
+  else if (! ( (COURSE_HOURS|COURSE_TYPE|COURSE_INSTR|COURSE_SIZE) & ~flag) )
+  {
+    crs_line.kind = CRS_COURSE;
+  }
+  else
+  {
+    oss << "Invalid course description at line " << line
+        << ": invalid format";
+    crs_line.vec_error.push_back (oss.str() );
+  }
 }
 
-bool Course::push_course (course_t &course)
+void Course::expand_course (course_t &course, vector<string> &vec_room_error) const
 {
-  if (m_mapstr_course.find (course.id) != m_mapstr_course.end() )
-    return true;
-
   double k;
   int i;
   bs_t bs;
 
   string str;
-  string group;
 
-  map<string, room_t>::iterator begin_it;
-  map<string, room_t>::iterator end_it;
-  map<string, room_t>::iterator it;
+  map<string, room_t>::const_iterator begin_it;
+  map<string, room_t>::const_iterator end_it;
+  map<string, room_t>::const_iterator it;
 
   stringstream oss;
 
+  vector<string_view> vec_tok;
+  split (course.room_id, ':', vec_tok);
+
   // Test for multiple room entries
-  if (course.const_room && token_count (course.room_id, ":") > 1)
+  if (course.const_room && vec_tok.size() > 1)
   {
-    Debug debug;
     // Must be false or vec_prooms wont be looked at
     course.const_room = false;
 
-    for (i = 0; i < token_count (course.room_id, ":"); i++)
+    for (auto it_tok = vec_tok.begin(); it_tok != vec_tok.end(); it_tok++)
     {
-      str = get_token (course.room_id, i, ":");
+      str = *it_tok;
 
-      if (m_mapstr_labrooms.find (str) != m_mapstr_labrooms.end() )
-        course.vec_prooms.push_back (m_mapstr_labrooms[str]);
+      if ( (it = m_mapstr_labrooms.find (str) ) != m_mapstr_labrooms.end() )
+        course.vec_prooms.push_back (it->second);
 
-      else if (m_mapstr_stdrooms.find (str) != m_mapstr_stdrooms.end() )
-        course.vec_prooms.push_back (m_mapstr_stdrooms[str]);
+      else if ( (it = m_mapstr_stdrooms.find (str) ) != m_mapstr_stdrooms.end() )
+        course.vec_prooms.push_back (it->second);
 
       else
+      {
         oss << "Invalid room for " << course.id << ": " << str;
-        debug.push_error (oss.str() );
+        vec_room_error.push_back (oss.str() );
         oss.str ("");
+      }
     }
 
     course.room_id = "";
-    debug.live_or_die();
   }
   else if (!course.const_room)
   {
@@ -401,22 +543,21 @@ bool Course::push_course (course_t &course)
       course.vec_avail_times.push_back (make_bitsched (course.start_time, course.end_time, course.days) );
   }
 
-  else if (course.is_lab && prog_opts["CONTIGUOUS-LABS"] == "TRUE")
+  else if (course.is_lab && m_contiguous_labs)
     for (i = 0; i < 5; i++)
-      for (k = atoi (prog_opts["LAB-START-TIME"].c_str() );
-           k + course.hours <= atoi (prog_opts["LAB-END-TIME"].c_str() );
-           k += 0.5)
+      for (k = m_lab_start; k + course.hours <= m_lab_end; k += 0.5)
       {
         bs = make_bitsched (k, k + course.hours, 2 << i);
 
         if (course.multi_days)
+        {
           for (auto it = course.vec_days.begin(); it != course.vec_days.end(); it++)
             if (! (course.const_time && ( (make_bitsched (course.start_time, course.end_time, 2) ^ bs) & MASK_TIME).any() ) && // dummy day
                 ! (course.const_days && ( (make_bitsched (12.0, 13.0, *it) ^ bs) & MASK_DAY).any() ) ) // dummy time
             {
               course.vec_avail_times.push_back (bs);
             }
-
+        }
         else if (! (course.const_time && ( (make_bitsched (course.start_time, course.end_time, 2) ^ bs) & MASK_TIME).any() ) && // dummy day
                  ! (course.const_days && ( (make_bitsched (12.0, 13.0, course.days) ^ bs) & MASK_DAY).any() ) ) // dummy time
         {
@@ -434,15 +575,19 @@ bool Course::push_course (course_t &course)
   }
 
   else if (course.multi_days)
+  {
     for (auto it_day = course.vec_days.begin(); it_day != course.vec_days.end(); it_day++)
-      for (auto it_bs = sched_bs_idx[course.hours].begin(); it_bs != sched_bs_idx[course.hours].end(); it++)
+      for (auto it_bs = sched_bs_idx[course.hours].begin(); it_bs != sched_bs_idx[course.hours].end(); it_bs++)
         if ( (*it_bs >> 56 ^ static_cast<bs_t> (*it_day) ).none() )
-          course.vec_avail_times.push_back(*it_bs);
+          course.vec_avail_times.push_back (*it_bs);
+  }
 
   else if (course.const_days)
+  {
     for (auto it = sched_bs_idx[course.hours].begin(); it != sched_bs_idx[course.hours].end(); it++)
       if ( (*it >> 56 ^ static_cast<bs_t> (course.days) ).none() )
         course.vec_avail_times.push_back (*it);
+  }
 
   else
     for (auto it = sched_bs_idx[course.hours].begin(); it != sched_bs_idx[course.hours].end(); it++)
@@ -450,22 +595,51 @@ bool Course::push_course (course_t &course)
 
   /*
     Update vec_core/vec_elec depending on group membership.  The group file was read at
-    the beginning of c'tor Course()
+    the beginning of read_csv()
+  */
+  split (course.group, ':', vec_tok);
+  merge_groups (course.vec_avoid, vec_tok, m_mapstr_core, course.name);
+  merge_groups (course.vec_elec,  vec_tok, m_mapstr_elec, course.name);
+
+  /*
+    Biases do not change, so they are scored once for every candidate time.
+    Instructors without a listing in the bias CSV score 0 whether interned or
+    not, so they are looked up rather than interned here.
   */
-  for (i = 0; i < token_count (course.group, ":"); i++)
+  vector<int> vec_instr_sym;
+
+  for (auto it = course.vec_instr.begin(); it != course.vec_instr.end(); it++)
+    vec_instr_sym.push_back (m_sym_instr.find (*it) );
+
+  for (auto it = course.vec_avail_times.begin(); it != course.vec_avail_times.end(); it++)
   {
-    group = get_token (course.group, i, ":");
+    int bias = 0;
 
-    for (auto it = m_mapstr_core[group].begin(); it != m_mapstr_core[group].end(); it++)
-      if (find (course.vec_avoid.begin(), course.vec_avoid.end(), *it) == course.vec_avoid.end() && *it != course.name)
-        course.vec_avoid.push_back (*it);
+    for (auto it_instr = vec_instr_sym.begin(); it_instr != vec_instr_sym.end(); it_instr++)
+      bias += get_bias (*it_instr, *it);
 
-    for (auto it = m_mapstr_elec[group].begin(); it != m_mapstr_elec[group].end(); it++)
-      if (find (course.vec_elec.begin(), course.vec_elec.end(), *it) == course.vec_elec.end() && *it != course.name)
-        course.vec_elec.push_back (*it);
+    // Check for global blocks
+    if (get_bias (m_bias_all, *it) == SCORE_VOID)
+      bias += SCORE_VOID;
+
+    course.vec_bias.push_back (bias);
   }
+}
+
+bool Course::push_course (course_t &course, const vector<string> &vec_room_error)
+{
+  if (m_mapstr_course.find (course.id) != m_mapstr_course.end() )
+    return true;
 
-  m_mapstr_course[course.id] = course;
+  Debug debug;
+
+  for (auto it = vec_room_error.begin(); it != vec_room_error.end(); it++)
+    debug.push_error (*it);
+
+  debug.live_or_die();
+
+  intern_course (course);
+  swap (m_mapstr_course[course.id], course);
   return false;
 }
 
@@ -475,6 +649,26 @@ bool Course::push_const_course (course_t &course)
     return true;
 
   course.bs_sched = make_bitsched (course.start_time, course.end_time, course.days);
+  intern_course (course);
   m_mapstr_const_course[course.id] = course;
   return false;
 }
+
+void Course::intern_course (course_t &course)
+{
+  course.name_sym = m_sym_crs.intern (course.name);
+  course.room_sym = course.room_id == "" ? -1 : m_sym_room.intern (course.room_id);
+
+  course.vec_avoid_sym.clear();
+  course.vec_elec_sym.clear();
+  course.vec_instr_sym.clear();
+
+  for (auto it = course.vec_avoid.begin(); it != course.vec_avoid.end(); it++)
+    course.vec_avoid_sym.push_back (m_sym_crs.intern (*it) );
+
+  for (auto it = course.vec_elec.begin(); it != course.vec_elec.end(); it++)
+    course.vec_elec_sym.push_back (m_sym_crs.intern (*it) );
+
+  for (auto it = course.vec_instr.begin(); it != course.vec_instr.end(); it++)
+    course.vec_instr_sym.push_back (m_sym_instr.intern (*it) );
+}
@@ -20,14 +20,56 @@
 #if !defined(COURSE_HPP)
 #define COURSE_HPP
 
-#include <fstream>
+#include <functional>
 #include <map>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "bias.hpp"
+#include "mapfile.hpp"
 #include "room.hpp"
 #include "utility.hpp"
 
+/*!
+  Courses of each group by group name.  The comparator is transparent so a
+  group is found from a string_view without building a string.
+*/
+typedef std::map<std::string, std::vector<std::string>, std::less<> > group_map_t;
+
+/*!
+  Whether a line of the course CSV holds a course to schedule, a constant
+  course, or neither
+*/
+enum e_crs_line
+{
+  CRS_NONE, CRS_COURSE, CRS_CONST
+};
+
+/*!
+  A line of the course CSV once parsed:
+
+  line:
+    the line number, counting from 1
+
+  course:
+    the course on the line, expanded by expand_course if it is to be scheduled
+
+  vec_error:
+    errors in the line, in the order they were found
+
+  vec_room_error:
+    errors for rooms of course that do not exist
+*/
+struct crs_line_t
+{
+  int line;
+  e_crs_line kind;
+  course_t course;
+  std::vector<std::string> vec_error;
+  std::vector<std::string> vec_room_error;
+};
+
 /*!
   Course descriptions are read from a CSV and pushed to the appropriate map.
   Returns true if an entry for the course id already exists.  Group descriptions
@@ -40,35 +82,82 @@ class Course : public Bias, public Room
 {
 public:
   /*!
-    The constructor does all the work by reading the CSV contents for courses
-    and groups.  If the CSV contains an error, then the program will exit
-    after writing the error(s) to debug.log.
+    Reads the instructor, room, group, and course CSVs in that order.  If a CSV
+    contains an error, then the program will exit after writing the error(s)
+    to debug.log.
+  */
+  void read_csv           ();
+
+  /*!
+    Parses a line of the course CSV into crs_line, without saving it.  Safe to
+    call from several threads at once.
+  */
+  void parse_course       (std::string_view read_line, int line, crs_line_t &crs_line);
+
+  /*!
+    Called from read_csv to parse and expand the lines [first, last) of
+    vec_read into vec_line
+  */
+  void parse_thread (
+    std::vector<crs_line_t>         &vec_line,
+    const std::vector<std::string_view> &vec_read,
+    int                             first,
+    int                             last);
+
+  /*!
+    Fills in the rooms and times course can be scheduled in, the courses it
+    avoids and takes as electives through its groups, and the bias of each
+    time.  Rooms that do not exist are added to vec_room_error.  Only reads
+    rooms, groups, and biases, so courses can be expanded on several threads.
   */
-  Course();
+  void expand_course      (course_t &course, std::vector<std::string> &vec_room_error) const;
 
-  /*! Used to save course information read in by the c'tor */
-  bool push_course        (course_t &course);
+  /*!
+    Used to save a course expanded by expand_course, exiting with the errors in
+    vec_room_error if there are any
+  */
+  bool push_course        (course_t &course, const std::vector<std::string> &vec_room_error);
 
-  /*! Used to save course information read in by the c'tor */
+  /*! Used to save course information read in by read_csv */
   bool push_const_course  (course_t &course);
 
+  /*!
+    Called from push_course and push_const_course to resolve the course name,
+    avoidances, electives, instructors, and room to their interned symbols
+  */
+  void intern_course      (course_t &course);
+
   /*! Holds data for constant courses that do not need to be schedules */
   std::map<std::string, course_t> m_mapstr_const_course;
 
   /*! Holds data for courses needing to be scheduled */
   std::map<std::string, course_t> m_mapstr_course;
 
-  /*! Holds group data from the groups CSV file read in by the c'tor */
-  std::map<std::string, std::vector<std::string> > m_mapstr_core;
-  std::map<std::string, std::vector<std::string> > m_mapstr_elec;
+  /*! Holds group data from the groups CSV file read in by read_csv */
+  group_map_t m_mapstr_core;
+  group_map_t m_mapstr_elec;
+
+  /*!
+    Interned course names used by the universal indices, instructors are
+    interned in Bias::m_sym_instr
+  */
+  symtab_t m_sym_crs;
 
 
 private:
+  /*!
+    CONTIGUOUS-LABS, LAB-START-TIME, and LAB-END-TIME, read once so that
+    expand_course does not touch prog_opts from threads
+  */
+  bool m_contiguous_labs;
+  int m_lab_start;
+  int m_lab_end;
+
   /*! For referencing the course CSV file */
-  std::ifstream course_file;
+  mapfile_t course_file;
 
   /*! For referencing the group CSV file */
-  std::ifstream group_file;
+  mapfile_t group_file;
 };
 
 /*!
@@ -78,6 +167,9 @@ namespace
 {
 /*! Number of tokens per line in courses.csv*/
 const int COURSE_TOKENS = 12;
+
+/*! Fewest lines of courses.csv parsed by each thread */
+const int COURSE_CHUNK  = 256;
 const uint32_t COURSE_AVOID = 1 <<  0;
 const uint32_t COURSE_DAYS  = 1 <<  1;
 const uint32_t COURSE_GROUP = 1 <<  2;
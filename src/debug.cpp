@@ -20,6 +20,7 @@
 #include <iostream>
 
 #include "debug.hpp"
+#include "utility.hpp"
 
 using namespace std;
 
@@ -31,7 +32,7 @@ void Debug::live_or_die()
   if (!m_vec_warnings.size() && !m_vec_errors.size() )
     return;
 
-  debug_log.open ("debug.log", ios::app);
+  debug_log.open (output_path (FILE_DEBUG).c_str(), ios::app);
 
   while (m_vec_warnings.size() )
   {
@@ -51,8 +52,7 @@ void Debug::live_or_die()
 
     cout << endl << "Catastrophic failure: see debug.log" << endl;
     debug_log.close();
-    system ("pause");
-    exit (1);
+    exit (EXIT_ERROR);
   }
 
   debug_log.close();
@@ -27,15 +27,16 @@
 /*!
   Debug class is used to track errors and warnings throughout program execution.
   live_or_die checks for errors and warnings and outputs them to debug.log.
-  If an error is found, the program exits after sending a short message to the
-  console.
+  If an error is found, the program exits with EXIT_ERROR after sending a
+  short message to the console.
 */
 class Debug
 {
 public:
   /*!
-    Checks for errors and warnings and outputs them to debug.log.  If an error
-    is found, the program exits after sending a short message to the console.
+    Checks for errors and warnings and outputs them to debug.log in OUTPUT-DIR.
+    If an error is found, the program exits with EXIT_ERROR after sending a
+    short message to the console.
   */
   void live_or_die();
 
@@ -0,0 +1,311 @@
+/*
+ *    SACS, a Simulated Annealing Class Scheduler
+ *    Copyright (C) 2011-2012  Martin Wyngaarden
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include "graph.hpp"
+#include "utility.hpp"
+
+using namespace std;
+
+
+namespace
+{
+struct edge_t
+{
+  int d;
+  uint8_t kind;
+  float weight;
+
+  bool operator< (const edge_t &rhs) const
+  {
+    return d < rhs.d;
+  };
+};
+
+/*! Returns the room course is always in, or -1 if it has a choice */
+int fixed_room (const course_t &course)
+{
+  if (course.const_room)
+    return course.room_sym;
+
+  return course.vec_prooms.size() == 1 ? course.vec_prooms[0].sym : -1;
+}
+
+/*! Returns true if c and d conflict other than through electives */
+bool hard_edge (const graph_t &graph, int c, int d)
+{
+  auto first = graph.vec_adj.begin() + graph.vec_start[c];
+  auto last  = graph.vec_adj.begin() + graph.vec_start[c + 1];
+  auto it    = lower_bound (first, last, d);
+
+  return it != last && *it == d && (graph.vec_kind[it - graph.vec_adj.begin()] & EDGE_HARD);
+}
+}
+
+void graph_build (
+  graph_t               &graph,
+  const vector<course_t> &vec_crs,
+  double                avoid,
+  double                elec,
+  double                instr,
+  double                room)
+{
+  int c;
+  int crs_syms   = 0;
+  int instr_syms = 0;
+  int room_syms  = 0;
+  int n = static_cast<int> (vec_crs.size() );
+
+  for (auto it = vec_crs.begin(); it != vec_crs.end(); it++)
+  {
+    crs_syms = max (crs_syms, it->name_sym + 1);
+    room_syms = max (room_syms, fixed_room (*it) + 1);
+
+    for (auto it_sym = it->vec_avoid_sym.begin(); it_sym != it->vec_avoid_sym.end(); it_sym++)
+      crs_syms = max (crs_syms, *it_sym + 1);
+
+    for (auto it_sym = it->vec_elec_sym.begin(); it_sym != it->vec_elec_sym.end(); it_sym++)
+      crs_syms = max (crs_syms, *it_sym + 1);
+
+    for (auto it_sym = it->vec_instr_sym.begin(); it_sym != it->vec_instr_sym.end(); it_sym++)
+      instr_syms = max (instr_syms, *it_sym + 1);
+  }
+
+  // Courses by interned course, by what they avoid or elect, instructor, and room
+  vector<vector<int> > vec_by_name (crs_syms);
+  vector<vector<int> > vec_by_avoid (crs_syms);
+  vector<vector<int> > vec_by_elec (crs_syms);
+  vector<vector<int> > vec_by_instr (instr_syms);
+  vector<vector<int> > vec_by_room (room_syms);
+
+  for (c = 0; c < n; c++)
+  {
+    const course_t &course = vec_crs[c];
+    vec_by_name[course.name_sym].push_back (c);
+
+    for (auto it = course.vec_avoid_sym.begin(); it != course.vec_avoid_sym.end(); it++)
+      vec_by_avoid[*it].push_back (c);
+
+    for (auto it = course.vec_elec_sym.begin(); it != course.vec_elec_sym.end(); it++)
+      vec_by_elec[*it].push_back (c);
+
+    for (auto it = course.vec_instr_sym.begin(); it != course.vec_instr_sym.end(); it++)
+      if (find (course.vec_instr_sym.begin(), it, *it) == it)
+        vec_by_instr[*it].push_back (c);
+
+    if (fixed_room (course) >= 0)
+      vec_by_room[fixed_room (course)].push_back (c);
+  }
+
+  vector<edge_t> vec_row;
+
+  auto add = [&] (const vector<int> &vec_member, uint8_t kind, double weight)
+  {
+    for (auto it = vec_member.begin(); it != vec_member.end(); it++)
+    {
+      edge_t edge;
+      edge.d = *it;
+      edge.kind = kind;
+      edge.weight = static_cast<float> (weight);
+
+      if (edge.d != c)
+        vec_row.push_back (edge);
+    }
+  };
+
+  graph.vec_start.assign (1, 0);
+  graph.vec_adj.clear();
+  graph.vec_kind.clear();
+  graph.vec_weight.clear();
+
+  for (c = 0; c < n; c++)
+  {
+    const course_t &course = vec_crs[c];
+    vec_row.clear();
+
+    for (auto it = course.vec_avoid_sym.begin(); it != course.vec_avoid_sym.end(); it++)
+      add (vec_by_name[*it], EDGE_AVOIDS, avoid);
+
+    for (auto it = course.vec_elec_sym.begin(); it != course.vec_elec_sym.end(); it++)
+      add (vec_by_name[*it], EDGE_ELECTS, elec);
+
+    add (vec_by_avoid[course.name_sym], EDGE_AVOIDED, avoid);
+    add (vec_by_elec[course.name_sym], EDGE_ELECTED, elec);
+
+    for (auto it = course.vec_instr_sym.begin(); it != course.vec_instr_sym.end(); it++)
+      if (find (course.vec_instr_sym.begin(), it, *it) == it)
+        add (vec_by_instr[*it], EDGE_INSTR, instr);
+
+    if (fixed_room (course) >= 0)
+      add (vec_by_room[fixed_room (course)], EDGE_ROOM, room);
+
+    // Merge the relations of each pair of courses into one edge
+    sort (vec_row.begin(), vec_row.end() );
+
+    for (auto it = vec_row.begin(); it != vec_row.end(); it++)
+    {
+      if (graph.vec_adj.size() > static_cast<size_t> (graph.vec_start.back() ) &&
+          graph.vec_adj.back() == it->d)
+      {
+        graph.vec_kind.back() |= it->kind;
+        graph.vec_weight.back() += it->weight;
+        continue;
+      }
+
+      graph.vec_adj.push_back (it->d);
+      graph.vec_kind.push_back (it->kind);
+      graph.vec_weight.push_back (it->weight);
+    }
+
+    graph.vec_start.push_back (static_cast<int> (graph.vec_adj.size() ) );
+  }
+}
+
+void graph_stats (const graph_t &graph, graph_stats_t &stats)
+{
+  int b, c, d, e;
+  int k;
+  int n = graph.size();
+
+  double weight;
+
+  stats.edges        = static_cast<long> (graph.vec_adj.size() ) / 2;
+  stats.hard_edges   = 0;
+  stats.min_degree   = n ? INF : 0;
+  stats.max_degree   = 0;
+  stats.mean_degree  = n ? 2.0 * stats.edges / n : 0.0;
+  stats.max_weight   = 0.0;
+  stats.clique       = n ? 1 : 0;
+  stats.clique_bound = n ? 1 : 0;
+  stats.vec_degree_hist.clear();
+
+  vector<int> vec_hard (n, 0);
+
+  for (c = 0; c < n; c++)
+  {
+    stats.min_degree = min (stats.min_degree, graph.degree (c) );
+    stats.max_degree = max (stats.max_degree, graph.degree (c) );
+
+    for (b = 0; (1 << b) <= graph.degree (c); b++);
+
+    if (b >= static_cast<int> (stats.vec_degree_hist.size() ) )
+      stats.vec_degree_hist.resize (b + 1, 0);
+
+    stats.vec_degree_hist[b]++;
+
+    for (e = graph.vec_start[c], weight = 0.0; e < graph.vec_start[c + 1]; e++)
+    {
+      weight += graph.vec_weight[e];
+
+      if (graph.vec_kind[e] & EDGE_HARD)
+        vec_hard[c]++;
+    }
+
+    stats.hard_edges += vec_hard[c];
+    stats.max_weight = max (stats.max_weight, weight);
+  }
+
+  stats.hard_edges /= 2;
+
+  /*
+    Core numbers over hard edges, removing a course of least remaining degree
+    at a time.  The largest is the degeneracy, and a clique cannot be larger
+    than the core number of any of its courses plus one.
+  */
+  vector<int> vec_core (vec_hard);
+  vector<int> vec_order;
+  vector<bool> vec_done (n, false);
+  vector<vector<int> > vec_bucket (stats.max_degree + 1);
+
+  for (c = 0; c < n; c++)
+    vec_bucket[vec_core[c]].push_back (c);
+
+  for (k = 0; k <= stats.max_degree; )
+  {
+    if (vec_bucket[k].empty() )
+    {
+      k++;
+      continue;
+    }
+
+    c = vec_bucket[k].back();
+    vec_bucket[k].pop_back();
+
+    // Stale entries are left behind when a course's degree drops
+    if (vec_done[c] || vec_core[c] != k)
+      continue;
+
+    vec_done[c] = true;
+    vec_order.push_back (c);
+    stats.clique_bound = max (stats.clique_bound, k + 1);
+
+    for (e = graph.vec_start[c]; e < graph.vec_start[c + 1]; e++)
+    {
+      d = graph.vec_adj[e];
+
+      if (! (graph.vec_kind[e] & EDGE_HARD) || vec_done[d] || vec_core[d] <= k)
+        continue;
+
+      vec_bucket[--vec_core[d]].push_back (d);
+      k = min (k, vec_core[d]);
+    }
+  }
+
+  /*
+    Greedy cliques grown from each course, trying neighbours of higher core
+    number first.  Courses whose core number rules out a larger clique than
+    the one found are skipped.
+  */
+  vector<int> vec_cand;
+  vector<int> vec_clique;
+
+  for (auto it = vec_order.rbegin(); it != vec_order.rend(); it++)
+  {
+    c = *it;
+
+    if (vec_core[c] + 1 <= stats.clique)
+      continue;
+
+    vec_cand.clear();
+
+    for (e = graph.vec_start[c]; e < graph.vec_start[c + 1]; e++)
+      if ( (graph.vec_kind[e] & EDGE_HARD) && vec_core[graph.vec_adj[e]] >= stats.clique)
+        vec_cand.push_back (graph.vec_adj[e]);
+
+    sort (vec_cand.begin(), vec_cand.end(), [&] (int x, int y)
+    {
+      return vec_core[x] > vec_core[y] || (vec_core[x] == vec_core[y] && x < y);
+    });
+
+    vec_clique.assign (1, c);
+
+    for (auto it_cand = vec_cand.begin(); it_cand != vec_cand.end(); it_cand++)
+    {
+      bool all = true;
+
+      for (auto it_clq = vec_clique.begin(); it_clq != vec_clique.end() && all; it_clq++)
+        all = hard_edge (graph, *it_cand, *it_clq);
+
+      if (all)
+        vec_clique.push_back (*it_cand);
+    }
+
+    stats.clique = max (stats.clique, static_cast<int> (vec_clique.size() ) );
+  }
+}
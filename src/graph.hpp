@@ -0,0 +1,132 @@
+/*
+ *    SACS, a Simulated Annealing Class Scheduler
+ *    Copyright (C) 2011-2012  Martin Wyngaarden
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#if !defined(GRAPH_HPP)
+#define GRAPH_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "utility.hpp"
+
+/*!
+  How course c relates to course d for an edge from c to d.  An edge may be of
+  several kinds.
+
+    EDGE_AVOIDED:   d avoids c, so the health of d looks at the time of c
+    EDGE_AVOIDS:    c avoids d
+    EDGE_ELECTED:   d takes c as an elective
+    EDGE_ELECTS:    c takes d as an elective
+    EDGE_INSTR:     c and d share an instructor
+    EDGE_ROOM:      c and d can only be in the same room
+
+  Rooms are only an edge when neither course has a choice of room.  Otherwise
+  which courses share a room changes while annealing and is found through
+  state_t::vec_room_crs.  Electives do not keep a course from being scheduled,
+  every other kind is a hard conflict.
+*/
+enum e_edge
+{
+  EDGE_AVOIDED  = 0x01,
+  EDGE_AVOIDS   = 0x02,
+  EDGE_ELECTED  = 0x04,
+  EDGE_ELECTS   = 0x08,
+  EDGE_INSTR    = 0x10,
+  EDGE_ROOM     = 0x20,
+  EDGE_HARD     = EDGE_AVOIDED | EDGE_AVOIDS | EDGE_INSTR | EDGE_ROOM
+};
+
+/*!
+  Conflict graph of the courses to schedule in compressed sparse row form,
+  indexed the same as the vector of courses it was built from.  The courses
+  next to c are vec_adj[vec_start[c], vec_start[c + 1]), in increasing order,
+  with the kind and weight of each edge at the same index.
+
+  Weights add the coefficient of each relation, so a shared instructor and an
+  avoidance weigh CMUL_INSTR + CMUL_AVOID.  The graph is symmetric: d is next
+  to c with the same weight as c is next to d.
+*/
+struct graph_t
+{
+  int size() const
+  {
+    return static_cast<int> (vec_start.size() ) - 1;
+  };
+
+  int degree (int c) const
+  {
+    return vec_start[c + 1] - vec_start[c];
+  };
+
+  std::vector<int> vec_start;
+  std::vector<int> vec_adj;
+  std::vector<uint8_t> vec_kind;
+  std::vector<float> vec_weight;
+};
+
+/*!
+  Summary of a conflict graph for capacity planning:
+
+  edges, hard_edges:
+    the number of pairs of courses that conflict, and that conflict other than
+    through electives
+
+  min_degree, max_degree, mean_degree, max_weight:
+    degrees over all edges, and the greatest sum of edge weights of a course
+
+  vec_degree_hist:
+    the number of courses with degree 0, 1, 2-3, 4-7, 8-15, and so on
+
+  clique, clique_bound:
+    the size of the largest set of courses found that all conflict with each
+    other, and an upper bound on it, the degeneracy of the graph plus one, both
+    over hard edges.  Each course of such a set needs a time of its own.
+*/
+struct graph_stats_t
+{
+  long edges;
+  long hard_edges;
+
+  int min_degree;
+  int max_degree;
+  double mean_degree;
+  double max_weight;
+
+  std::vector<int> vec_degree_hist;
+
+  int clique;
+  int clique_bound;
+};
+
+/*!
+  Builds graph from vec_crs, weighing avoidances, electives, instructors and
+  rooms with the coefficients given
+*/
+void graph_build (
+  graph_t                         &graph,
+  const std::vector<course_t>     &vec_crs,
+  double                          avoid,
+  double                          elec,
+  double                          instr,
+  double                          room);
+
+/*! Fills stats for graph */
+void graph_stats (const graph_t &graph, graph_stats_t &stats);
+
+#endif // !defined(GRAPH_HPP)
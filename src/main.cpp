@@ -17,9 +17,11 @@
  */
 
 #include <algorithm>
+#include <filesystem>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <map>
 #include <sstream>
 #include <string>
 
@@ -30,7 +32,35 @@
 using namespace std;
 
 
-int main()
+namespace
+{
+/*! Options whose values are paths, kept as they are rather than upper cased */
+bool is_path_option (const string &option)
+{
+  return option == "CONFIG" || option == "INPUT-DIR" || option == "OUTPUT-DIR";
+}
+
+void usage()
+{
+  cerr << "Usage: sacs [OPTION=VALUE]..." << endl << endl
+       << "  config=FILE       read options from FILE, by default sched.cfg in the" << endl
+       << "                    input directory" << endl
+       << "  input-dir=DIR     read the CSV files, html_header.txt, and the snapshot" << endl
+       << "                    from DIR, by default the current directory" << endl
+       << "  output-dir=DIR    write the schedules and debug.log to DIR, by default" << endl
+       << "                    the current directory" << endl
+       << "  overwrite=POLICY  yes, no, or ask before saving over existing schedules" << endl << endl
+       << "Any option of sched.cfg can be given the same way, and takes precedence" << endl
+       << "over the configuration file." << endl;
+}
+}
+
+/*!
+  Exits with an e_exit status.  Nothing is read from the console unless
+  OVERWRITE is ASK and there are schedules to overwrite, so sacs can be run
+  unattended with overwrite=yes or overwrite=no.
+*/
+int main (int argc, char *argv[])
 {
   std::cout << "SACS, a Simulated Annealing Class Scheduler" << endl
             << "Copyright (C) 2011  Martin Wyngaarden (wyngaardenm@gmail.com)"
@@ -38,27 +68,56 @@ int main()
             << "Compiled " << COMPILE_DATE << " at " << COMPILE_TIME
             << endl << endl;
 
-  prog_opts["BUFFER"]          = "4";
-  prog_opts["CONTIGUOUS-LABS"] = "TRUE";
-  prog_opts["LAB-START-TIME"]  = "8";
-  prog_opts["LAB-END-TIME"]    = "21";
-  prog_opts["POLL"]            = "10";
-  prog_opts["REDUCTION"]       = "0.99";
-  prog_opts["VERBOSE"]         = "TRUE";
+  opts_init();
 
   size_t found;
 
   string str;
   string option;
   string value;
+  string config;
 
+  map<string, string> arg_opts;
   fstream config_file;
   stringstream oss;
   Debug debug;
-  config_file.open (FILE_CONFIG);
+
+  // Options given on the command line, applied over those of the config file
+  for (int i = 1; i < argc; i++)
+  {
+    str    = argv[i];
+    found  = str.find ("=");
+    option = make_upper (str.substr (0, found) );
+
+    if (found == string::npos || (option != "CONFIG" && prog_opts.find (option) == prog_opts.end() ) )
+    {
+      cerr << "Invalid argument: " << str << endl << endl;
+      usage();
+      return EXIT_USAGE;
+    }
+
+    value = str.substr (found + 1);
+    arg_opts[option] = is_path_option (option) ? value : make_upper (value);
+  }
+
+  if (arg_opts.count ("INPUT-DIR") )
+    prog_opts["INPUT-DIR"] = arg_opts["INPUT-DIR"];
+
+  config = arg_opts.count ("CONFIG") ? arg_opts["CONFIG"] : input_path (FILE_CONFIG);
+  arg_opts.erase ("CONFIG");
+
+  config_file.open (config.c_str(), ios::in);
 
   if (!config_file.is_open() )
-    std::cout << "Configuration file (" << FILE_CONFIG << ") not found: using defaults!" << endl;
+  {
+    if (config != input_path (FILE_CONFIG) )
+    {
+      cerr << "Configuration file (" << config << ") not found" << endl;
+      return EXIT_USAGE;
+    }
+
+    std::cout << "Configuration file (" << config << ") not found: using defaults!" << endl;
+  }
 
   // Read options from config file
   else
@@ -68,7 +127,6 @@ int main()
       if (str.empty() )
         continue;
 
-      str = make_upper (str);
       // Remove whitespaces
       found = str.find (" ");
 
@@ -82,9 +140,12 @@ int main()
       if (str.substr (0, 1) == "#")
         continue;
 
-      option = get_token (str, 0, "=");
+      option = make_upper (get_token (str, 0, "=") );
       value  = get_token (str, 1, "=");
 
+      if (!is_path_option (option) )
+        value = make_upper (value);
+
       if (option == "" || value == "")
         continue;
 
@@ -101,6 +162,27 @@ int main()
   }
 
   config_file.close();
+
+  for (auto it = arg_opts.begin(); it != arg_opts.end(); it++)
+    prog_opts[it->first] = it->second;
+
+  // Checked before anything is written to debug.log in OUTPUT-DIR
+  const char *vec_dir[] = { "INPUT-DIR", "OUTPUT-DIR" };
+
+  for (auto it = begin (vec_dir); it != end (vec_dir); it++)
+  {
+    if (prog_opts[*it] != "" && !filesystem::is_directory (prog_opts[*it]) )
+    {
+      cerr << "Directory (" << prog_opts[*it] << ") not found" << endl;
+      return EXIT_USAGE;
+    }
+  }
+
+  value = prog_opts["OVERWRITE"];
+
+  if (value != "ASK" && value != "YES" && value != "NO")
+    debug.push_error ("Invalid overwrite policy: " + value);
+
   debug.live_or_die();
 
   // Precompute certain indices
@@ -108,15 +190,20 @@ int main()
 
   Schedule sched;
 
+  if (prog_opts["SNAPSHOT"] == "COMPILE")
+  {
+    std::cout << endl << "Snapshot written to " << input_path (FILE_SNAPSHOT) << endl << endl;
+    return EXIT_OK;
+  }
+
   std::cout << endl << "Optimizing schedule..." << endl << endl;
 
   sched.optimize();
 
   std::cout << endl
-            << "Optimization complete (" << sched.duration() << " seconds)"
+            << "Optimization complete (" << fixed << setprecision (2)
+            << sched.duration() << " seconds)"
             << endl << endl;
 
-  std::system ("pause");
-  return 0;
+  return sched.saved() ? EXIT_OK : EXIT_EXISTS;
 }
-
@@ -0,0 +1,129 @@
+/*
+ *    SACS, a Simulated Annealing Class Scheduler
+ *    Copyright (C) 2011-2012  Martin Wyngaarden
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MAPFILE_MMAP
+#endif
+
+#include "mapfile.hpp"
+
+using namespace std;
+
+
+mapfile_t::mapfile_t() :
+  m_data (nullptr), m_size (0), m_pos (0), m_open (false), m_mapped (false)
+{
+}
+
+mapfile_t::~mapfile_t()
+{
+  close();
+}
+
+bool mapfile_t::open (const string &path)
+{
+  close();
+
+#if defined(MAPFILE_MMAP)
+  int fd = ::open (path.c_str(), O_RDONLY);
+
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+
+  // Empty files cannot be mapped and are read like any other unmapped file
+  if (fstat (fd, &st) == 0 && S_ISREG (st.st_mode) && st.st_size > 0)
+  {
+    void *addr = mmap (nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (addr != MAP_FAILED)
+    {
+      madvise (addr, st.st_size, MADV_SEQUENTIAL);
+      m_data   = static_cast<const char *> (addr);
+      m_size   = st.st_size;
+      m_mapped = true;
+    }
+  }
+
+  ::close (fd);
+#endif
+
+  if (!m_mapped)
+  {
+    ifstream file (path.c_str(), ios::binary);
+
+    if (!file.is_open() )
+      return false;
+
+    ostringstream oss;
+    oss << file.rdbuf();
+    m_buf  = oss.str();
+    m_data = m_buf.data();
+    m_size = m_buf.size();
+  }
+
+  m_pos  = 0;
+  m_open = true;
+  return true;
+}
+
+void mapfile_t::close()
+{
+#if defined(MAPFILE_MMAP)
+  if (m_mapped)
+    munmap (const_cast<char *> (m_data), m_size);
+#endif
+
+  m_buf.clear();
+  m_buf.shrink_to_fit();
+
+  m_data   = nullptr;
+  m_size   = 0;
+  m_pos    = 0;
+  m_open   = false;
+  m_mapped = false;
+}
+
+bool mapfile_t::getline (string_view &line)
+{
+  if (m_pos >= m_size)
+    return false;
+
+  const char *first = m_data + m_pos;
+  const char *last  = static_cast<const char *> (memchr (first, '\n', m_size - m_pos) );
+
+  if (last == nullptr)
+    last = m_data + m_size;
+
+  m_pos = last - m_data + 1;
+
+  if (last > first && last[-1] == '\r')
+    last--;
+
+  line = string_view (first, last - first);
+  return true;
+}
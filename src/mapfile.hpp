@@ -0,0 +1,86 @@
+/*
+ *    SACS, a Simulated Annealing Class Scheduler
+ *    Copyright (C) 2011-2012  Martin Wyngaarden
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#if !defined(MAPFILE_HPP)
+#define MAPFILE_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/*!
+  Read only input file, mapped into memory where the platform allows and read
+  into a buffer otherwise.  Lines are views into the file, so nothing is copied
+  unless it has to be changed:
+
+    mapfile_t file;
+
+    if (file.open ("rooms.csv") )
+      while (file.getline (line) )
+        ...
+
+  Lines are split at '\n' and a trailing '\r' is removed, so CRLF line endings
+  are stripped on every platform, and a last line without a newline is still a
+  line.  Views are valid until the file is closed.
+*/
+class mapfile_t
+{
+public:
+  mapfile_t();
+  ~mapfile_t();
+
+  mapfile_t (const mapfile_t &) = delete;
+  mapfile_t &operator= (const mapfile_t &) = delete;
+
+  /*! Returns false if path could not be opened */
+  bool open             (const std::string &path);
+  void close            ();
+
+  bool is_open() const
+  {
+    return m_open;
+  };
+
+  /*! The whole file, valid until it is closed */
+  const char *data() const
+  {
+    return m_data;
+  };
+
+  size_t size() const
+  {
+    return m_size;
+  };
+
+  /*! Sets line to the next line, returns false at the end of the file */
+  bool getline          (std::string_view &line);
+
+private:
+  const char *m_data;
+  size_t m_size;
+  size_t m_pos;
+
+  bool m_open;
+  bool m_mapped;
+
+  /*! Contents of the file when it could not be mapped */
+  std::string m_buf;
+};
+
+#endif // !defined(MAPFILE_HPP)
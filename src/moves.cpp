@@ -0,0 +1,512 @@
+/*
+ *    SACS, a Simulated Annealing Class Scheduler
+ *    Copyright (C) 2011-2012  Martin Wyngaarden
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+  Moves other than MOVE_SWAP.  A state is scored by scheduling its courses in
+  order, each course counting its collisions with the courses before it, so a
+  local move changing the slot of course c only changes the health of c and
+  of the courses after it that look at the bit schedule of c.  Those are its
+  neighbours in the conflict graph and the courses in its rooms, and they are
+  rescored against the bit schedules of the courses before them, without
+  rescheduling anything.
+*/
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+#include "schedule.hpp"
+#include "utility.hpp"
+
+using namespace std;
+
+
+e_move Schedule::pick_move (prng_t &my_rng)
+{
+  int m;
+  double r;
+
+  // Swaps alone draw nothing, so runs match those made before moves were added
+  if (m_move_weight[MOVE_SWAP] == m_move_total)
+    return MOVE_SWAP;
+
+  r = rand_unitintvl (my_rng) * m_move_total;
+
+  for (m = 0; m + 1 < MOVES; m++)
+  {
+    if (r < m_move_weight[m])
+      break;
+
+    r -= m_move_weight[m];
+  }
+
+  // Rounding may leave r past the last weight
+  while (m_move_weight[m] <= 0.0)
+    m--;
+
+  return static_cast<e_move> (m);
+}
+
+int Schedule::pick_course (const state_t &state, prng_t &my_rng)
+{
+  int c = 0;
+
+  for (int n = 0; n < MOVE_PROBES; n++)
+  {
+    c = my_rng() % state.vec_order.size();
+
+    if (!can_schedule (state.vec_slot[c].health) )
+      break;
+  }
+
+  return c;
+}
+
+bool Schedule::local_move (chain_t &chain, e_move move, double temp)
+{
+  int i, n;
+  int pmin = INF;
+
+  double delta;
+
+  state_t &state = chain.state;
+  const uidx_t &base = m_const_uidx;
+  const health_t health = state.health;
+
+  static thread_local vector<pair<int, slot_t> > vec_undo;
+  static thread_local vector<pair<int, int> > vec_kempe;
+  vec_undo.clear();
+
+  int c = pick_course (state, chain.rng);
+  const course_t &course = m_vec_crs[c];
+  const slot_t slot = state.vec_slot[c];
+
+  switch (move)
+  {
+    case MOVE_TIME:
+      n = static_cast<int> (course.vec_avail_times.size() );
+
+      if (n < 2)
+        return false;
+
+      i = chain.rng() % (n - 1);
+      set_slot (state, base, c, i < slot.time ? i : i + 1, slot.room, vec_undo);
+      break;
+
+    case MOVE_ROOM:
+      n = static_cast<int> (course.vec_prooms.size() );
+
+      if (course.const_room || n < 2)
+        return false;
+
+      i = chain.rng() % (n - 1);
+      set_slot (state, base, c, slot.time, i < slot.room ? i : i + 1, vec_undo);
+      break;
+
+    case MOVE_KEMPE:
+      if (!kempe_chain (state, c, chain.rng, vec_kempe) )
+        return false;
+
+      for (auto it = vec_kempe.begin(); it != vec_kempe.end(); it++)
+        set_slot (state, base, it->first, it->second, state.vec_slot[it->first].room, vec_undo);
+
+      break;
+
+    default:
+      assert (false);
+      return false;
+  }
+
+  state.health.fitness = get_score (state.health, state.vec_order.size() );
+  delta = state.health.fitness - health.fitness;
+
+  if (delta < 0 || exp (-delta / temp) > rand_unitintvl (chain.rng) )
+  {
+    for (auto it = vec_undo.begin(); it != vec_undo.end(); it++)
+      pmin = min (pmin, state.vec_pos[it->first]);
+
+    chain.chkpt.stale = min (chain.chkpt.stale, pmin);
+    return true;
+  }
+
+  // Restore the slots in the reverse order they were changed
+  for (auto it = vec_undo.rbegin(); it != vec_undo.rend(); it++)
+  {
+    const course_t &moved = m_vec_crs[it->first];
+    slot_t &cur_slot = state.vec_slot[it->first];
+
+    if (room_sym (moved, cur_slot) != room_sym (moved, it->second) )
+      move_room (state, it->first, room_sym (moved, cur_slot), room_sym (moved, it->second) );
+
+    cur_slot = it->second;
+  }
+
+  state.health = health;
+  return false;
+}
+
+void Schedule::set_slot (
+  state_t                         &state,
+  const uidx_t                    &base,
+  int                             c,
+  int                             time,
+  int                             room,
+  vector<pair<int, slot_t> >      &vec_undo)
+{
+  int d;
+  int k;
+  int n;
+  int s;
+
+  bs_t bs;
+
+  const course_t &course = m_vec_crs[c];
+  const slot_t prev = state.vec_slot[c];
+  int pos = state.vec_pos[c];
+
+  if (time == prev.time && room == prev.room)
+    return;
+
+  slot_t next = prev;
+  next.time = time;
+  next.room = room;
+
+  const bs_t &bs_prev = course.vec_avail_times[prev.time];
+  const bs_t &bs_next = course.vec_avail_times[next.time];
+  int room_prev = room_sym (course, prev);
+  int room_next = room_sym (course, next);
+
+  /*
+    Collisions of the courses after c with the bit schedule of c, with and
+    without the move.  Courses are collected in vec_hit, and the change to
+    their health in vec_delta, indexed by course.
+  */
+  static thread_local vector<int> vec_hit;
+  static thread_local vector<int> vec_mark;
+  static thread_local vector<health_t> vec_delta;
+
+  if (vec_mark.size() != m_vec_crs.size() )
+    vec_mark.assign (m_vec_crs.size(), -1);
+
+  vec_hit.clear();
+  vec_delta.clear();
+
+  auto hit = [&] (int e) -> health_t &
+  {
+    if (vec_mark[e] < 0)
+    {
+      vec_mark[e] = static_cast<int> (vec_hit.size() );
+      vec_hit.push_back (e);
+      vec_delta.push_back (health_t() );
+      vec_delta.back().reset();
+    }
+
+    return vec_delta[vec_mark[e]];
+  };
+
+  if (bs_prev != bs_next)
+  {
+    for (k = m_graph.vec_start[c]; k < m_graph.vec_start[c + 1]; k++)
+    {
+      d = m_graph.vec_adj[k];
+      uint8_t kind = m_graph.vec_kind[k];
+
+      if (state.vec_pos[d] < pos || ! (kind & (EDGE_AVOIDED | EDGE_ELECTED | EDGE_INSTR) ) )
+        continue;
+
+      const course_t &nbr = m_vec_crs[d];
+      const bs_t &bs_d = nbr.vec_avail_times[state.vec_slot[d].time];
+      health_t &dh = hit (d);
+
+      if (kind & (EDGE_AVOIDED | EDGE_ELECTED) )
+      {
+        s = course.name_sym;
+        bs = prefix_bs (state, m_crs_by_name[s], base.crs[s], c, state.vec_pos[d]);
+        n = num_conflicts ( (bs | bs_next) & bs_d) - num_conflicts ( (bs | bs_prev) & bs_d);
+
+        if (kind & EDGE_AVOIDED)
+          dh.avoid_colls += n;
+
+        if (kind & EDGE_ELECTED)
+          dh.elec_colls += n;
+      }
+
+      if (! (kind & EDGE_INSTR) )
+        continue;
+
+      for (auto it_instr = course.vec_instr_sym.begin(); it_instr != course.vec_instr_sym.end(); it_instr++)
+      {
+        s = *it_instr;
+
+        // The instructor index is ORed with the bit schedule of c only once
+        if (find (course.vec_instr_sym.begin(), it_instr, s) != it_instr)
+          continue;
+
+        if ( (n = static_cast<int> (count (nbr.vec_instr_sym.begin(), nbr.vec_instr_sym.end(), s) ) ) )
+        {
+          bs = prefix_bs (state, m_crs_by_instr[s], base.instr[s], c, state.vec_pos[d]);
+          dh.instr_colls += n * (num_conflicts ( (bs | bs_next) & bs_d) - num_conflicts ( (bs | bs_prev) & bs_d) );
+        }
+      }
+    }
+  }
+
+  // The rooms left and taken, once if the room is the same
+  for (k = 0; k < 2; k++)
+  {
+    s = k ? room_next : room_prev;
+
+    if (s < 0 || (k && s == room_prev) )
+      continue;
+
+    const bs_t bs_was = room_prev == s ? bs_prev : bs_t();
+    const bs_t bs_now = room_next == s ? bs_next : bs_t();
+
+    for (auto it = state.vec_room_crs[s].begin(); it != state.vec_room_crs[s].end(); it++)
+      if (state.vec_pos[d = *it] > pos)
+      {
+        const bs_t &bs_d = m_vec_crs[d].vec_avail_times[state.vec_slot[d].time];
+        bs = prefix_bs (state, state.vec_room_crs[s], base.room[s], c, state.vec_pos[d]);
+        hit (d).room_colls += num_conflicts ( (bs | bs_now) & bs_d) - num_conflicts ( (bs | bs_was) & bs_d);
+      }
+  }
+
+  // Move c and rescore it against the courses before it
+  vec_undo.push_back (make_pair (c, prev) );
+  sub_health (state.health, course, prev);
+
+  if (room_prev != room_next)
+  {
+    move_room (state, c, room_prev, room_next);
+    next.health.buf_fitness = abs (m_room_buf - (course.vec_prooms[room].size - course.size) );
+  }
+
+  score_slot (state, base, c, next);
+  next.health.bias_fitness = course.vec_bias[time];
+  state.vec_slot[c] = next;
+  add_health (state.health, course, next);
+
+  // Then the courses after it
+  for (size_t h = 0; h < vec_hit.size(); h++)
+  {
+    d = vec_hit[h];
+    vec_mark[d] = -1;
+
+    const health_t &dh = vec_delta[h];
+    slot_t &slot = state.vec_slot[d];
+
+    if (!dh.avoid_colls && !dh.elec_colls && !dh.instr_colls && !dh.room_colls)
+      continue;
+
+    vec_undo.push_back (make_pair (d, slot) );
+    sub_health (state.health, m_vec_crs[d], slot);
+    slot.health.avoid_colls += dh.avoid_colls;
+    slot.health.elec_colls  += dh.elec_colls;
+    slot.health.instr_colls += dh.instr_colls;
+    slot.health.room_colls  += dh.room_colls;
+    add_health (state.health, m_vec_crs[d], slot);
+  }
+}
+
+void Schedule::score_slot (const state_t &state, const uidx_t &base, int c, slot_t &slot)
+{
+  int s;
+  int pos = state.vec_pos[c];
+
+  const course_t &course = m_vec_crs[c];
+  const bs_t &bs = course.vec_avail_times[slot.time];
+
+  slot.health.avoid_colls = 0;
+  slot.health.elec_colls  = 0;
+  slot.health.instr_colls = 0;
+  slot.health.room_colls  = 0;
+
+  for (auto it = course.vec_avoid_sym.begin(); it != course.vec_avoid_sym.end(); it++)
+    slot.health.avoid_colls += num_conflicts (prefix_bs (state, m_crs_by_name[*it], base.crs[*it], c, pos) & bs);
+
+  for (auto it = course.vec_elec_sym.begin(); it != course.vec_elec_sym.end(); it++)
+    slot.health.elec_colls += num_conflicts (prefix_bs (state, m_crs_by_name[*it], base.crs[*it], c, pos) & bs);
+
+  for (auto it = course.vec_instr_sym.begin(); it != course.vec_instr_sym.end(); it++)
+    slot.health.instr_colls += num_conflicts (prefix_bs (state, m_crs_by_instr[*it], base.instr[*it], c, pos) & bs);
+
+  if ( (s = room_sym (course, slot) ) >= 0)
+    slot.health.room_colls = num_conflicts (prefix_bs (state, state.vec_room_crs[s], base.room[s], c, pos) & bs);
+}
+
+bs_t Schedule::prefix_bs (
+  const state_t                   &state,
+  const vector<int>               &vec_member,
+  const bs_t                      &base,
+  int                             c,
+  int                             pos)
+{
+  bs_t bs = base;
+
+  for (auto it = vec_member.begin(); it != vec_member.end(); it++)
+    if (*it != c && state.vec_pos[*it] < pos)
+      bs |= m_vec_crs[*it].vec_avail_times[state.vec_slot[*it].time];
+
+  return bs;
+}
+
+bool Schedule::kempe_chain (
+  const state_t                   &state,
+  int                             c,
+  prng_t                          &my_rng,
+  vector<pair<int, int> >         &vec_kempe)
+{
+  int d = -1;
+  int n = 0;
+  bool hits = false;
+
+  static thread_local vector<int> vec_nbr;
+
+  bs_t bs_c = m_vec_crs[c].vec_avail_times[state.vec_slot[c].time];
+  bs_t bs_d;
+  bs_t bs_to;
+
+  // Pick a course c collides with at another time, or failing that any neighbour
+  vec_nbr.clear();
+  get_neighbours (state, c, vec_nbr);
+
+  for (auto it = vec_nbr.begin(); it != vec_nbr.end(); it++)
+  {
+    const bs_t &bs = m_vec_crs[*it].vec_avail_times[state.vec_slot[*it].time];
+    bool coll = num_conflicts (bs & bs_c) > 0;
+
+    if (bs == bs_c || (hits && !coll) )
+      continue;
+
+    if (coll && !hits)
+      n = 0;
+
+    hits = hits || coll;
+
+    if (! (my_rng() % ++n) )
+      d = *it;
+  }
+
+  if (d < 0)
+    return false;
+
+  bs_d = m_vec_crs[d].vec_avail_times[state.vec_slot[d].time];
+
+  /*
+    Every course in the chain moves from one of the two times to the other, so
+    the courses it collides with in the time it moves to must move as well
+  */
+  vec_kempe.clear();
+  vec_kempe.push_back (make_pair (c, -1) );
+
+  for (size_t k = 0; k < vec_kempe.size(); k++)
+  {
+    const int e = vec_kempe[k].first;
+    const course_t &course = m_vec_crs[e];
+
+    bs_to = course.vec_avail_times[state.vec_slot[e].time] == bs_c ? bs_d : bs_c;
+    auto it_bs = find (course.vec_avail_times.begin(), course.vec_avail_times.end(), bs_to);
+
+    if (it_bs == course.vec_avail_times.end() )
+      return false;
+
+    vec_kempe[k].second = static_cast<int> (it_bs - course.vec_avail_times.begin() );
+
+    vec_nbr.clear();
+    get_neighbours (state, e, vec_nbr);
+
+    for (auto it = vec_nbr.begin(); it != vec_nbr.end(); it++)
+    {
+      if (m_vec_crs[*it].vec_avail_times[state.vec_slot[*it].time] != bs_to)
+        continue;
+
+      bool found = false;
+
+      for (auto it_k = vec_kempe.begin(); it_k != vec_kempe.end() && !found; it_k++)
+        found = it_k->first == *it;
+
+      if (found)
+        continue;
+
+      if (vec_kempe.size() == KEMPE_MAX)
+        return false;
+
+      vec_kempe.push_back (make_pair (*it, -1) );
+    }
+  }
+
+  return true;
+}
+
+void Schedule::get_neighbours (const state_t &state, int c, vector<int> &vec_nbr)
+{
+  int room = room_sym (m_vec_crs[c], state.vec_slot[c]);
+
+  for (int e = m_graph.vec_start[c]; e < m_graph.vec_start[c + 1]; e++)
+    if (m_graph.vec_kind[e] & EDGE_HARD)
+      vec_nbr.push_back (m_graph.vec_adj[e]);
+
+  if (room >= 0)
+    for (auto it = state.vec_room_crs[room].begin(); it != state.vec_room_crs[room].end(); it++)
+      if (*it != c)
+        vec_nbr.push_back (*it);
+}
+
+void Schedule::move_room (state_t &state, int c, int from, int to)
+{
+  if (from >= 0)
+  {
+    vector<int> &vec_crs = state.vec_room_crs[from];
+    auto it = find (vec_crs.begin(), vec_crs.end(), c);
+    assert (it != vec_crs.end() );
+    *it = vec_crs.back();
+    vec_crs.pop_back();
+  }
+
+  if (to >= 0)
+    state.vec_room_crs[to].push_back (c);
+}
+
+void Schedule::display_moves (const vector<chain_t> &vec_chain)
+{
+  const char *move_name[MOVES] = { "swap", "front", "time", "room", "kempe" };
+
+  cout << setw (8) << left << "move" << right
+       << setw (12) << "tried" << setw (12) << "accepted" << endl;
+
+  for (int m = 0; m < MOVES; m++)
+  {
+    int tries = 0;
+    int accepts = 0;
+
+    for (auto it = vec_chain.begin(); it != vec_chain.end(); it++)
+    {
+      tries += it->move_tries[m];
+      accepts += it->move_accepts[m];
+    }
+
+    if (!tries)
+      continue;
+
+    cout << setw (8) << left << move_name[m] << right
+         << setw (12) << tries << setw (12) << accepts
+         << fixed << setprecision (1) << setw (8) << 100.0 * accepts / tries << "%" << endl;
+  }
+
+  cout << endl;
+}
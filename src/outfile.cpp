@@ -0,0 +1,275 @@
+/*
+ *    SACS, a Simulated Annealing Class Scheduler
+ *    Copyright (C) 2011-2012  Martin Wyngaarden
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cfloat>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#define OUTFILE_FSYNC
+#else
+#include <io.h>
+#endif
+
+#include "outfile.hpp"
+
+using namespace std;
+
+
+namespace
+{
+/*! Size of the buffer, anything longer is written straight to the file */
+const size_t OUTFILE_BUF = 1 << 20;
+
+/*! Enough for any integer up to 64 bits and its sign */
+const size_t INT_CHARS = 24;
+
+/*! Enough for any double in fixed notation, less its decimals */
+const size_t DOUBLE_CHARS = DBL_MAX_10_EXP + 3;
+
+const uint64_t FNV_OFFSET = 0xcbf29ce484222325ULL;
+const uint64_t FNV_PRIME  = 0x100000001b3ULL;
+
+/*! Returns false if what was written to file could not be put on disk */
+bool sync_file (FILE *file)
+{
+  if (fflush (file) != 0)
+    return false;
+
+#if defined(OUTFILE_FSYNC)
+  return fsync (fileno (file) ) == 0;
+#else
+  return _commit (_fileno (file) ) == 0;
+#endif
+}
+
+/*! Puts the entry of a renamed file on disk along with its directory */
+void sync_dir (const string &path)
+{
+#if defined(OUTFILE_FSYNC)
+  string dir = filesystem::path (path).parent_path().string();
+  int fd = ::open (dir.empty() ? "." : dir.c_str(), O_RDONLY);
+
+  if (fd >= 0)
+  {
+    fsync (fd);
+    ::close (fd);
+  }
+#endif
+}
+}
+
+outfile_t::outfile_t() :
+  m_file (nullptr), m_prec (6), m_good (false), m_pending (false), m_bytes (0),
+  m_hash (FNV_OFFSET), m_len (0)
+{
+}
+
+outfile_t::~outfile_t()
+{
+  discard();
+}
+
+bool outfile_t::open (const string &path, bool binary)
+{
+  discard();
+
+  m_path     = path;
+  m_tmp_path = path + ".tmp";
+
+  // Text files in text mode, so lines end as they would through an ofstream
+  if ( (m_file = fopen (m_tmp_path.c_str(), binary ? "wb" : "w") ) == nullptr)
+    return false;
+
+  // The buffer here replaces the one of the FILE
+  setvbuf (m_file, nullptr, _IONBF, 0);
+
+  m_buf.resize (OUTFILE_BUF);
+  m_len     = 0;
+  m_prec    = 6;
+  m_good    = true;
+  m_pending = true;
+  m_bytes   = 0;
+  m_hash    = FNV_OFFSET;
+  return true;
+}
+
+bool outfile_t::close()
+{
+  if (m_file == nullptr)
+    return false;
+
+  flush();
+
+  if (!sync_file (m_file) )
+    m_good = false;
+
+  if (fclose (m_file) != 0)
+    m_good = false;
+
+  m_file = nullptr;
+
+  m_buf.clear();
+  m_buf.shrink_to_fit();
+  m_len = 0;
+
+  return m_good;
+}
+
+bool outfile_t::commit()
+{
+  if (m_file != nullptr || !m_pending || !m_good)
+    return false;
+
+  error_code ec;
+  filesystem::rename (m_tmp_path, m_path, ec);
+
+  if (ec)
+    return false;
+
+  m_pending = false;
+  sync_dir (m_path);
+  return true;
+}
+
+void outfile_t::discard()
+{
+  if (m_file != nullptr)
+  {
+    fclose (m_file);
+    m_file = nullptr;
+  }
+
+  if (m_pending)
+  {
+    remove (m_tmp_path.c_str() );
+    m_pending = false;
+  }
+
+  m_buf.clear();
+  m_buf.shrink_to_fit();
+  m_len  = 0;
+  m_good = false;
+}
+
+void outfile_t::flush()
+{
+  if (m_len)
+    write (m_buf.data(), m_len);
+
+  m_len = 0;
+}
+
+void outfile_t::write (const char *data, size_t n)
+{
+  // Whatever is written to a file that is not open is dropped, as by an ofstream
+  if (m_file == nullptr || fwrite (data, 1, n, m_file) != n)
+  {
+    m_good = false;
+    return;
+  }
+
+  for (size_t i = 0; i < n; i++)
+    m_hash = (m_hash ^ static_cast<unsigned char> (data[i]) ) * FNV_PRIME;
+
+  m_bytes += n;
+}
+
+char *outfile_t::reserve (size_t n)
+{
+  if (m_len + n > m_buf.size() )
+    flush();
+
+  if (n > m_buf.size() )
+    m_buf.resize (n);
+
+  return &m_buf[m_len];
+}
+
+outfile_t &outfile_t::operator<< (string_view str)
+{
+  if (str.size() >= m_buf.size() )
+  {
+    flush();
+    write (str.data(), str.size() );
+  }
+
+  else
+  {
+    memcpy (reserve (str.size() ), str.data(), str.size() );
+    m_len += str.size();
+  }
+
+  return *this;
+}
+
+outfile_t &outfile_t::operator<< (char c)
+{
+  *reserve (1) = c;
+  m_len++;
+  return *this;
+}
+
+template<typename T>
+outfile_t &outfile_t::put_int (T n)
+{
+  char *first = reserve (INT_CHARS);
+  m_len = to_chars (first, first + INT_CHARS, n).ptr - m_buf.data();
+  return *this;
+}
+
+outfile_t &outfile_t::operator<< (int n)
+{
+  return put_int (n);
+}
+
+outfile_t &outfile_t::operator<< (long n)
+{
+  return put_int (n);
+}
+
+outfile_t &outfile_t::operator<< (long long n)
+{
+  return put_int (n);
+}
+
+outfile_t &outfile_t::operator<< (unsigned n)
+{
+  return put_int (n);
+}
+
+outfile_t &outfile_t::operator<< (unsigned long n)
+{
+  return put_int (n);
+}
+
+outfile_t &outfile_t::operator<< (unsigned long long n)
+{
+  return put_int (n);
+}
+
+outfile_t &outfile_t::operator<< (double d)
+{
+  size_t n    = DOUBLE_CHARS + m_prec;
+  char *first = reserve (n);
+  m_len = to_chars (first, first + n, d, chars_format::fixed, m_prec).ptr - m_buf.data();
+  return *this;
+}
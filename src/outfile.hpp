@@ -0,0 +1,138 @@
+/*
+ *    SACS, a Simulated Annealing Class Scheduler
+ *    Copyright (C) 2011-2012  Martin Wyngaarden
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#if !defined(OUTFILE_HPP)
+#define OUTFILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+/*!
+  Write only output file.  Text is formatted into a buffer, numbers with
+  std::to_chars, and the buffer is written out whenever it fills and when the
+  file is closed, so a file takes a few large writes:
+
+    outfile_t file;
+
+    if (file.open ("scheduled.csv") )
+      file << id << "," << hours << "\n";
+
+    if (file.close() && file.commit() )
+      ...
+
+  Doubles are written in fixed notation with precision() decimals, the same
+  text as an ostream set to std::fixed.  Nothing is flushed per line, so write
+  "\n" rather than std::endl.
+
+  The file is written to path.tmp, which close syncs to disk and commit renames
+  to path, so path is never seen half written.  A file that is not committed is
+  removed when discarded or destroyed, leaving any earlier path as it was.
+*/
+class outfile_t
+{
+public:
+  outfile_t();
+  ~outfile_t();
+
+  outfile_t (const outfile_t &) = delete;
+  outfile_t &operator= (const outfile_t &) = delete;
+
+  /*!
+    Returns false if the temporary file for path could not be created.  A
+    binary file is written as is, with no line ending translation.
+  */
+  bool open             (const std::string &path, bool binary = false);
+
+  /*! Returns false if anything written since open was lost */
+  bool close            ();
+
+  /*!
+    Renames the closed file to the path it was opened with.  Returns false if
+    it was not written in full or could not be renamed.
+  */
+  bool commit           ();
+
+  /*! Closes the file and removes it unless it was committed */
+  void discard          ();
+
+  /*! Bytes written since open, and their FNV-1a hash */
+  uint64_t bytes() const
+  {
+    return m_bytes;
+  };
+
+  uint64_t hash() const
+  {
+    return m_hash;
+  };
+
+  bool is_open() const
+  {
+    return m_file != nullptr;
+  };
+
+  /*! Decimals written for doubles, 6 by default */
+  void precision (int prec)
+  {
+    m_prec = prec;
+  };
+
+  outfile_t &operator<< (std::string_view str);
+  outfile_t &operator<< (char c);
+  outfile_t &operator<< (int n);
+  outfile_t &operator<< (long n);
+  outfile_t &operator<< (long long n);
+  outfile_t &operator<< (unsigned n);
+  outfile_t &operator<< (unsigned long n);
+  outfile_t &operator<< (unsigned long long n);
+  outfile_t &operator<< (double d);
+
+private:
+  /*! Writes out the buffer */
+  void flush            ();
+
+  /*! Writes n characters from data to the file */
+  void write            (const char *data, size_t n);
+
+  /*! Makes room for at least n more characters, returning where they go */
+  char *reserve         (size_t n);
+
+  template<typename T>
+  outfile_t &put_int    (T n);
+
+  std::FILE *m_file;
+  int m_prec;
+  bool m_good;
+
+  /*! Path opened, and the temporary file written until commit */
+  std::string m_path;
+  std::string m_tmp_path;
+  bool m_pending;
+
+  uint64_t m_bytes;
+  uint64_t m_hash;
+
+  std::string m_buf;
+  size_t m_len;
+};
+
+#endif // !defined(OUTFILE_HPP)
@@ -20,6 +20,8 @@
 #include <iomanip>
 #include <iostream>
 #include <sstream>
+#include <string_view>
+#include <vector>
 
 #include "debug.hpp"
 #include "room.hpp"
@@ -28,55 +30,55 @@
 using namespace std;
 
 
-Room::Room()
+void Room::read_rooms()
 {
   if (prog_opts["VERBOSE"] == "TRUE")
     cout << setw (36) << left << "Reading room profiles... ";
 
   int  line;
   string read_str;
+  string_view read_line;
   uint32_t flag;
+  vector<string_view> vec_field;
   ostringstream oss;
   Debug debug;
-  room_file.open (FILE_ROOM);
-
-  if (!room_file.is_open() )
+  if (!room_file.open (input_path (FILE_ROOM) ) )
   {
-    read_str ="Unable to open " + FILE_ROOM;
+    read_str ="Unable to open " + input_path (FILE_ROOM);
     debug.push_error (read_str);
   }
 
   debug.live_or_die();
 
-  for (line = 1, flag = 0; getline (room_file, read_str); line++, flag = 0)
+  for (line = 1, flag = 0; room_file.getline (read_line); line++, flag = 0)
   {
-    if (read_str.empty() )
+    if (read_line.empty() )
       continue;
 
-    read_str = make_upper (read_str);
+    split (make_upper (read_line, read_str), ',', vec_field);
 
-    if (token_count (read_str, ",") < 3)
+    if (vec_field.size() < 3)
     {
       oss << "Ignoring room entry at line " << line
           << ":  invalid format";
-      debug.push_warning (oss.str() );
+      m_vec_room_warning.push_back (oss.str() );
       oss.str ("");
       continue;
     }
 
-    if (get_token (read_str, 0, ",") != "")
+    if (vec_field[0] != "")
       flag |= 4;
 
-    if (get_token (read_str, 1, ",") != "")
+    if (vec_field[1] != "")
       flag |= 2;
 
-    if (get_token (read_str, 2, ",") != "")
+    if (vec_field[2] != "")
       flag |= 1;
 
     if (!flag)
     {
       oss << "Ignoring room entry at line " << line << ": empty line";
-      debug.push_warning (oss.str() );
+      m_vec_room_warning.push_back (oss.str() );
       oss.str ("");
       continue;
     }
@@ -89,7 +91,7 @@ Room::Room()
       continue;
     }
 
-    if (get_token (read_str, 2, ",") != "L" && get_token (read_str, 2, ",") != "S")
+    if (vec_field[2] != "L" && vec_field[2] != "S")
     {
       oss << "Invalid room entry at line " << line
           << ": invalid room type, use S/L)";
@@ -98,26 +100,22 @@ Room::Room()
       continue;
     }
 
-    if (get_token (read_str, 2, ",") == "S")
+    if (vec_field[2] == "S")
     {
-      if (push_stdroom (
-            get_token (read_str, 0, ","),
-            atoi (get_token (read_str, 1, ",").c_str() ) ) )
+      if (push_stdroom (string (vec_field[0]), field_to_int (vec_field[1]) ) )
       {
         oss << "Ignoring room entry at line " << line << ": duplicate";
-        debug.push_warning (oss.str() );
+        m_vec_room_warning.push_back (oss.str() );
         oss.str ("");
         continue;
       }
     }
     else
     {
-      if (push_labroom (
-            get_token (read_str, 0, ","),
-            atoi (get_token (read_str, 1, ",").c_str() ) ) )
+      if (push_labroom (string (vec_field[0]), field_to_int (vec_field[1]) ) )
       {
         oss << "Ignoring room entry at line " << line << ": duplicate";
-        debug.push_warning (oss.str() );
+        m_vec_room_warning.push_back (oss.str() );
         oss.str ("");
         continue;
       }
@@ -129,6 +127,9 @@ Room::Room()
   if (prog_opts["VERBOSE"] == "TRUE")
     cout << "done" << endl;
 
+  for (auto it = m_vec_room_warning.begin(); it != m_vec_room_warning.end(); it++)
+    debug.push_warning (*it);
+
   debug.live_or_die();
 }
 
@@ -142,6 +143,7 @@ bool Room::push_stdroom (const string &id, int size)
 
   m_mapstr_stdrooms[id].id = id;
   m_mapstr_stdrooms[id].size = size;
+  m_mapstr_stdrooms[id].sym = m_sym_room.intern (id);
   return false;
 }
 
@@ -155,5 +157,6 @@ bool Room::push_labroom (const string &id, int size)
 
   m_mapstr_labrooms[id].id = id;
   m_mapstr_labrooms[id].size = size;
+  m_mapstr_labrooms[id].sym = m_sym_room.intern (id);
   return false;
 }
@@ -20,10 +20,11 @@
 #if !defined(ROOM_HPP)
 #define ROOM_HPP
 
-#include <fstream>
 #include <map>
 #include <string>
+#include <vector>
 
+#include "mapfile.hpp"
 #include "utility.hpp"
 
 /*!
@@ -40,11 +41,11 @@ class Room
 {
 public:
   /*!
-    The constructor does all the work by reading the CSV contents and filling
-    in the public maps.  If the CSV contains an error, then the program will
-    exit after writing the error(s) to debug.log.
+    Reads the CSV contents and fills in the public maps.  If the CSV contains
+    an error, then the program will exit after writing the error(s) to
+    debug.log.
   */
-  Room();
+  void read_rooms   ();
 
   /*! Called to save room information with an ID and room size */
   bool push_labroom (const std::string &id, int size);
@@ -58,9 +59,15 @@ public:
   /*! Maintains list of lecture/standard rooms */
   std::map<std::string, room_t> m_mapstr_stdrooms;
 
+  /*! Interned room IDs, including rooms only named in courses.csv */
+  symtab_t m_sym_room;
+
+  /*! Entries read_rooms ignored, kept for a snapshot to warn of them again */
+  std::vector<std::string> m_vec_room_warning;
+
 private:
   /*! Used for referencing the room CSV */
-  std::ifstream room_file;
+  mapfile_t room_file;
 };
 
 #endif // !defined(ROOM_HPP)
@@ -17,125 +17,730 @@
  */
 
 #include <algorithm>
-#include <fstream>
+#include <charconv>
+#include <cstdio>
+#include <ctime>
 #include <iomanip>
 #include <iostream>
 #include <map>
 #include <sstream>
+#include <thread>
 
 #include "debug.hpp"
 #include "schedule.hpp"
+#include "score.hpp"
 #include "utility.hpp"
 
 using namespace std;
 
 
+namespace
+{
+/*! Appends n to str as std::to_chars writes it */
+void append_int (string &str, int n)
+{
+  char buf[16];
+  str.append (buf, to_chars (buf, buf + sizeof (buf), n).ptr - buf);
+}
+}
+
+
 Schedule::Schedule() : Course()
 {
   string read_str;
+  string_view read_line;
   Debug debug;
-  header_file.open (FILE_HTML);
 
-  if (!header_file.is_open() )
+  m_saved = false;
+
+  if (!header_file.open (input_path (FILE_HTML) ) )
   {
-    read_str = "Unable to open " + FILE_HTML;
+    read_str = "Unable to open " + input_path (FILE_HTML);
     debug.push_error (read_str);
   }
 
   debug.live_or_die();
 
-  while (getline (header_file, read_str) )
-    m_vec_header.push_back (read_str);
+  while (header_file.getline (read_line) )
+    m_vec_header.emplace_back (read_line);
 
   header_file.close();
   m_rng.seed (static_cast<const uint32_t> (time (NULL) ) );
+
+  bool loaded = false;
+
+  if (prog_opts["SNAPSHOT"] == "LOAD")
+  {
+    if (prog_opts["VERBOSE"] == "TRUE")
+      cout << setw (36) << left << "Reading problem snapshot... ";
+
+    loaded = load_snapshot (read_str);
+
+    if (prog_opts["VERBOSE"] == "TRUE")
+      cout << (loaded ? "done" : read_str) << endl;
+  }
+  else if (prog_opts["SNAPSHOT"] != "COMPILE" && prog_opts["SNAPSHOT"] != "FALSE")
+  {
+    debug.push_error ("Invalid snapshot mode: " + prog_opts["SNAPSHOT"]);
+    debug.live_or_die();
+  }
+
+  if (!loaded)
+    read_csv();
+
+  // Index courses through a vector for speed
+  for (auto it = m_mapstr_course.begin(); it != m_mapstr_course.end(); it++)
+    m_vec_crs.push_back (it->second);
+
+  if ( (read_str = score_init (prog_opts["SIMD"]) ) == "")
+  {
+    debug.push_error ("Invalid instruction set: " + prog_opts["SIMD"]);
+    debug.live_or_die();
+  }
+
+  if (prog_opts["VERBOSE"] == "TRUE")
+  {
+    cout << setw (36) << left << "Candidate scorer: " << read_str;
+
+    // The CPU lacks what was asked for
+    if (prog_opts["SIMD"] != "AUTO" && prog_opts["SIMD"] != read_str)
+      cout << " (" << prog_opts["SIMD"] << " not supported)";
+
+    cout << endl;
+  }
+
+  // Read once so that perturb_state does not touch prog_opts from threads
+  m_incremental = prog_opts["INCREMENTAL"] == "TRUE";
+  m_room_buf    = atoi (prog_opts["BUFFER"].c_str() );
+  m_poll        = max (1, atoi (prog_opts["POLL"].c_str() ) );
+  m_reduction   = atof (prog_opts["REDUCTION"].c_str() );
+  m_temp_init   = prog_opts["TEMP-INIT"] == "AUTO" ? 0.0 : atof (prog_opts["TEMP-INIT"].c_str() );
+
+  if (prog_opts["COOLING"] == "LINEAR")
+    m_cooling = LINEAR;
+
+  else if (prog_opts["COOLING"] == "LOG")
+    m_cooling = LOG;
+
+  else if (prog_opts["COOLING"] == "LUNDY-MEES")
+    m_cooling = LUNDY_MEES;
+
+  else if (prog_opts["COOLING"] == "ADAPTIVE")
+    m_cooling = ADAPTIVE;
+
+  else if (prog_opts["COOLING"] == "GEOMETRIC")
+    m_cooling = GEOMETRIC;
+
+  else
+  {
+    debug.push_error ("Invalid cooling schedule: " + prog_opts["COOLING"]);
+    debug.live_or_die();
+  }
+
+  if (m_temp_init <= 0.0 && prog_opts["TEMP-INIT"] != "AUTO")
+  {
+    debug.push_error ("Invalid initial temperature: " + prog_opts["TEMP-INIT"]);
+    debug.live_or_die();
+  }
+
+  // Run lengths are counted in steps of REDUCTION, so it must lower the temperature
+  if (! (m_reduction > 0.0 && m_reduction < 1.0) )
+  {
+    debug.push_error ("Invalid temperature reduction: " + prog_opts["REDUCTION"]);
+    debug.live_or_die();
+  }
+
+  m_time_limit  = atof (prog_opts["TIME-LIMIT"].c_str() );
+  m_max_iters   = atoi (prog_opts["MAX-ITERATIONS"].c_str() );
+  m_stagnation  = atoi (prog_opts["STAGNATION"].c_str() );
+
+  if (! (m_time_limit >= 0.0 && m_time_limit < INF) )
+    debug.push_error ("Invalid time limit: " + prog_opts["TIME-LIMIT"]);
+
+  if (m_max_iters < 0)
+    debug.push_error ("Invalid iteration limit: " + prog_opts["MAX-ITERATIONS"]);
+
+  if (m_stagnation < 0)
+    debug.push_error ("Invalid stagnation limit: " + prog_opts["STAGNATION"]);
+
+  debug.live_or_die();
+  m_stop_sched  = prog_opts["STOP-SCHEDULED"] == "TRUE";
+
+  const char *move_opts[MOVES] = { "MOVE-SWAP", "MOVE-FRONT", "MOVE-TIME", "MOVE-ROOM", "MOVE-KEMPE" };
+  m_move_total = 0.0;
+
+  for (int m = 0; m < MOVES; m++)
+  {
+    m_move_weight[m] = atof (prog_opts[move_opts[m]].c_str() );
+    m_move_total += m_move_weight[m];
+
+    if (m_move_weight[m] < 0.0)
+      debug.push_error (string ("Invalid move weight: ") + move_opts[m] + " = " + prog_opts[move_opts[m]]);
+  }
+
+  if (m_move_total <= 0.0)
+    debug.push_error ("At least one MOVE-* weight must be greater than 0");
+
+  debug.live_or_die();
+
+  m_crs_by_name.resize (m_sym_crs.size() );
+  m_crs_by_instr.resize (m_sym_instr.size() );
+
+  for (int c = 0; c < static_cast<int> (m_vec_crs.size() ); c++)
+  {
+    const course_t &course = m_vec_crs[c];
+    m_crs_by_name[course.name_sym].push_back (c);
+
+    for (auto it = course.vec_instr_sym.begin(); it != course.vec_instr_sym.end(); it++)
+      m_crs_by_instr[*it].push_back (c);
+  }
+
+  // Set constants for room and instructor times in indices
+  m_const_uidx.resize (m_sym_crs.size(), m_sym_instr.size(), m_sym_room.size() );
+
+  for (auto it = m_mapstr_const_course.begin(); it != m_mapstr_const_course.end(); it++)
+    m_const_uidx.push (it->second);
+
+  if (!loaded)
+    graph_build (m_graph, m_vec_crs, CMUL_AVOID, CMUL_ELEC, CMUL_INSTR, CMUL_ROOM);
+
+  if (!loaded && prog_opts["SNAPSHOT"] != "FALSE")
+  {
+    if (!save_snapshot() )
+    {
+      if (prog_opts["SNAPSHOT"] == "COMPILE")
+        debug.push_error ("Unable to write " + input_path (FILE_SNAPSHOT) );
+
+      else
+        debug.push_warning ("Unable to write " + input_path (FILE_SNAPSHOT) );
+    }
+
+    debug.live_or_die();
+  }
+
+  if (prog_opts["GRAPH-STATS"] == "TRUE")
+    display_graph();
 }
 
 void Schedule::optimize()
 {
-  prng_t my_rng (m_rng() );
-  m_start_time = time (NULL);
-  double delta;
+  if (atoi (prog_opts["STARTS"].c_str() ) > 1)
+  {
+    multistart();
+    return;
+  }
 
-  // Annealing parameter
-  double reduction;
+  if (atoi (prog_opts["REPLICAS"].c_str() ) > 1)
+  {
+    temper();
+    return;
+  }
+
+  m_start_time = sched_clock_t::now();
 
+  vector<chain_t> vec_chain (1);
+  chain_t &chain = vec_chain[0];
+  init_chain (chain);
+
+  cout.precision (1);
+  run_chain (chain, prog_opts["VERBOSE"] == "TRUE", m_time_limit);
+
+  m_end_time = sched_clock_t::now();
+
+  if (prog_opts["VERBOSE"] == "TRUE")
+    display_moves (vec_chain);
+
+  m_best_fitness = chain.state.health.sched;
+  save_scheds (chain.state);
+}
+
+void Schedule::run_chain (chain_t &chain, bool verbose, double time_limit)
+{
   // Annealing parameter
   double temp;
 
   int i;
+  bool accepted;
 
-  // Interval between status updates
-  int poll_intvl = atoi (prog_opts["POLL"].c_str() );
+  run_t run;
+  init_run (run, chain, time_limit);
+  temp = run.temp_init;
 
+  if (verbose)
+    cout << fixed << scientific << "initial temperature = " << temp << endl;
+
+  // Begin annealing
+  for (i = 1; ; temp = cool (run, i++, temp, accepted ? 1.0 : 0.0) )
+  {
+    accepted = anneal (chain, temp);
+
+    // IO
+    if (verbose && ! (i % m_poll) )
+    {
+      cout << fixed << scientific << "temperature = " << temp << endl;
+      display_stats (chain.state, i);
+    }
+
+    // Are we done?
+    if (stop_run (run, chain.state, i, temp) )
+    {
+      if (verbose)
+        cout << "Stopped after " << i << " iterations: " << run.reason << endl;
+
+      return;
+    }
+  } // End annealing
+}
+
+void Schedule::init_run (run_t &run, chain_t &chain, double time_limit)
+{
+  run.temp_init    = m_temp_init > 0.0 ? m_temp_init : calibrate (chain);
+  run.start        = sched_clock_t::now();
+  run.time_limit   = time_limit;
+  run.length       = log (TEMP_MIN / run.temp_init) / log (m_reduction);
+  run.accept_ratio = 1.0;
+  run.best_fitness = 1.0e+30;
+  run.best_iter    = 0;
+  run.reason       = "";
+}
+
+double Schedule::calibrate (chain_t &chain)
+{
+  double delta;
+  double sum = 0.0;
+  int n = 0;
   health_t health;
-  state_t cur_state;
-  state_t best_state;
-  best_state.health.init();
 
-  // Index courses through a vector for speed
-  for (auto it = m_mapstr_course.begin(); it != m_mapstr_course.end(); it++)
-    best_state.vec_crs.push_back (it->second);
+  // Schedule every course once to have a state to perturb
+  anneal (chain, TEMP_INIT);
 
-  assert (best_state.vec_crs.size() );
+  for (int i = 0; i < TEMP_SAMPLES; i++)
+  {
+    perturb_state (chain.state, health, chain.cur_state, chain.rng, chain.chkpt);
+    delta = get_score (health, chain.state.vec_order.size() ) - chain.state.health.fitness;
+
+    if (delta > 0.0)
+    {
+      sum += delta;
+      n++;
+    }
+  }
+
+  // exp (-delta / temp) = TEMP_ACCEPT for the average uphill delta
+  return n ? -sum / n / log (TEMP_ACCEPT) : TEMP_INIT;
+}
+
+double Schedule::cool (run_t &run, int iter, double temp, double accepted)
+{
+  // Iterations left until TEMP_MIN should be reached
+  double left = max (1.0, run.length - iter);
+  double inv;
+  double target;
+  double x;
+
+  switch (m_cooling)
+  {
+  case LINEAR:
+    return temp - (temp - TEMP_MIN) / left;
+
+  case LOG:
+    inv = (1.0 / TEMP_MIN - 1.0 / temp) / log ( (1.0 + iter + left) / (1.0 + iter) );
+    return 1.0 / (1.0 / temp + inv * log ( (2.0 + iter) / (1.0 + iter) ) );
+
+  case LUNDY_MEES:
+    inv = (1.0 / TEMP_MIN - 1.0 / temp) / left;
+    return temp / (1.0 + inv * temp);
+
+  case ADAPTIVE:
+    /*
+      The target acceptance ratio falls from 1 to 0.44 over the first 15% of
+      the run, stays there until 35%, then falls towards 0
+    */
+    run.accept_ratio = (499.0 * run.accept_ratio + accepted) / 500.0;
+    x = iter / run.length;
+
+    if (x < 0.15)
+      target = 0.44 + 0.56 * pow (560.0, -x / 0.15);
+
+    else if (x < 0.35)
+      target = 0.44;
+
+    else
+      target = 0.44 * pow (440.0, - (x - 0.35) / 0.65);
+
+    return run.accept_ratio > target ? temp * m_reduction : temp / m_reduction;
+
+  default:
+    // Without a budget, keep to REDUCTION
+    if (run.time_limit > 0.0 || m_max_iters)
+      return temp * pow (TEMP_MIN / temp, 1.0 / left);
+
+    return temp * m_reduction;
+  }
+}
+
+bool Schedule::stop_run (run_t &run, const state_t &state, int iter, double temp)
+{
+  double elapsed = chrono::duration<double> (sched_clock_t::now() - run.start).count();
+  double remaining = 0.0;
+
+  if (state.health.fitness < run.best_fitness)
+  {
+    run.best_fitness = state.health.fitness;
+    run.best_iter = iter;
+  }
+
+  if (temp <= TEMP_MIN)
+    run.reason = "minimum temperature";
+
+  // The run would cool forever, ending only on a limit if there is one
+  else if (!isfinite (run.length) )
+    run.reason = "invalid run length";
+
+  else if (m_cooling == ADAPTIVE && iter >= run.length)
+    run.reason = "end of schedule";
+
+  else if (m_stop_sched && state.health.sched == static_cast<int> (state.vec_order.size() ) )
+    run.reason = "all courses scheduled";
+
+  else if (run.time_limit > 0.0 && elapsed >= run.time_limit)
+    run.reason = "time limit";
+
+  else if (m_max_iters && iter >= m_max_iters)
+    run.reason = "iteration limit";
+
+  else if (m_stagnation && iter - run.best_iter >= m_stagnation)
+    run.reason = "stagnation";
+
+  else
+  {
+    // Iterations left in the budget, estimated from the rate so far
+    if (run.time_limit > 0.0)
+      remaining = elapsed > 0.0 ? (run.time_limit - elapsed) * iter / elapsed : INF;
+
+    if (m_max_iters)
+      remaining = run.time_limit > 0.0 ? min (remaining, static_cast<double> (m_max_iters - iter) ) : m_max_iters - iter;
+
+    // Cool so that TEMP_MIN is reached as the budget runs out, once it is known
+    if (remaining > 0.0 && remaining < INF)
+      run.length = iter + remaining;
+
+    return false;
+  }
+
+  return true;
+}
+
+void Schedule::multistart()
+{
+  m_start_time = sched_clock_t::now();
+
+  int k, t;
+  int best;
+
+  int starts  = atoi (prog_opts["STARTS"].c_str() );
+  int threads = atoi (prog_opts["THREADS"].c_str() );
+
+  if (threads < 1)
+    threads = max (1, static_cast<int> (thread::hardware_concurrency() ) );
+
+  threads = min (threads, starts);
+
+  atomic<int> next (0);
+  vector<chain_t> vec_chain (starts);
+  vector<double> vec_fitness;
+  vector<thread> vec_thread;
+
+  for (k = 0; k < starts; k++)
+    init_chain (vec_chain[k]);
+
+  // Each thread runs its chains one after another within TIME-LIMIT
+  double time_limit = m_time_limit / ( (starts + threads - 1) / threads);
+
+  for (t = 0; t < threads; t++)
+    vec_thread.push_back (thread (&Schedule::multistart_thread, this, ref (vec_chain), ref (next), time_limit) );
+
+  for (auto it = vec_thread.begin(); it != vec_thread.end(); it++)
+    it->join();
+
+  m_end_time = sched_clock_t::now();
+
+  for (k = 0, best = 0; k < starts; k++)
+  {
+    const health_t &health = vec_chain[k].state.health;
+
+    cout << "start = " << setw (3) << right << k + 1
+         << "  seed = " << setw (10) << vec_chain[k].seed
+         << "  fitness = " << fixed << setprecision (4) << health.fitness
+         << " ( " << health.sched << " / " << vec_chain[k].state.vec_order.size() << " )"
+         << endl;
+
+    vec_fitness.push_back (health.fitness);
+
+    if (health.fitness < vec_chain[best].state.health.fitness)
+      best = k;
+  }
+
+  cout << endl
+       << "fitness: mean = " << mean (vec_fitness)
+       << "  stdev = " << stdevp (vec_fitness, mean (vec_fitness) )
+       << "  best = start " << best + 1 << endl;
+
+  if (prog_opts["VERBOSE"] == "TRUE")
+  {
+    cout << endl;
+    display_moves (vec_chain);
+  }
+
+  cout.precision (1);
+  m_best_fitness = vec_chain[best].state.health.sched;
+  save_scheds (vec_chain[best].state);
+}
+
+void Schedule::multistart_thread (
+  vector<chain_t>       &vec_chain,
+  atomic<int>           &next,
+  double                time_limit)
+{
+  for (int k = next++; k < static_cast<int> (vec_chain.size() ); k = next++)
+    run_chain (vec_chain[k], false, time_limit);
+}
+
+void Schedule::temper()
+{
+  m_start_time = sched_clock_t::now();
+
+  // Annealing parameter, temp is that of the coldest replica
+  double temp;
+
+  // Ratio of states the coldest replica accepted in the last round
+  double accepted = 1.0;
+
+  // Exchange criterion
+  double d;
+
+  int i, j, k, t;
+  int best;
+  int accepts;
+
+  int replicas   = atoi (prog_opts["REPLICAS"].c_str() );
+  int swap_intvl = max (1, atoi (prog_opts["SWAP-INTERVAL"].c_str() ) );
+  int threads    = atoi (prog_opts["THREADS"].c_str() );
+
+  if (threads < 1)
+    threads = max (1, static_cast<int> (thread::hardware_concurrency() ) );
+
+  threads = min (threads, replicas);
+
+  vector<chain_t> vec_chain (replicas);
+  vector<double> vec_temp (swap_intvl);
+  vector<thread> vec_thread;
+  rounds_t rounds;
+
+  for (k = 0; k < replicas; k++)
+    init_chain (vec_chain[k]);
+
+  // Exchanges are decided on the main thread so results do not depend on THREADS
+  prng_t swap_rng (m_rng() );
+
+  run_t run;
+  init_run (run, vec_chain[0], m_time_limit);
 
-  // Allocate enough room for the courses
-  cur_state.vec_crs.resize (best_state.vec_crs.size() );
   cout.precision (1);
-  reduction = atof (prog_opts["REDUCTION"].c_str() );
-  temp = TEMP_INIT;
+  temp = run.temp_init;
+
+  if (prog_opts["VERBOSE"] == "TRUE")
+    cout << fixed << scientific << "initial temperature = " << temp << endl;
+
+  // The workers wait for each round rather than being started for it
+  rounds.workers = threads;
+
+  for (t = 0; t < threads; t++)
+    vec_thread.push_back (thread (&Schedule::temper_thread, this, ref (vec_chain),
+                                  t, threads, cref (vec_temp), ref (rounds) ) );
 
   // Begin annealing
-  for (i = 0; ; ++i, temp *= reduction)
+  for (i = 0; ; i += swap_intvl, temp = cool (run, i, vec_temp.back(), accepted) )
   {
-    health.reset();
+    // Temperatures of the coldest replica for this round
+    for (j = 0, vec_temp[0] = temp; j + 1 < swap_intvl; j++)
+      vec_temp[j + 1] = cool (run, i + j + 1, vec_temp[j], accepted);
+
+    accepts = vec_chain[0].accepts;
 
-    // Get a psuedo-random schedule
-    perturb_state (best_state, health, cur_state.vec_crs, my_rng);
-    cur_state.health = health;
-    cur_state.health.fitness = get_score (health, cur_state.vec_crs.size() );
+    rounds.start();
+    rounds.wait();
 
-    //cur_state.health.fitness = static_cast<int>(cur_state.vec_crs.size()) - cur_state.health.sched;
-    delta = cur_state.health.fitness - best_state.health.fitness;
+    accepted = static_cast<double> (vec_chain[0].accepts - accepts) / swap_intvl;
 
     /*
-      If schedule is better, use it.  Use a worse schedule if the latter
-      condition hold true to anneal, that is, back out of local minima.
+      Exchange states between neighbouring temperatures, alternating between
+      even and odd pairs.  A colder replica always takes a better state from
+      its hotter neighbour, otherwise the Metropolis criterion is used.
     */
-    if (delta < 0 || exp (-delta / temp) > rand_unitintvl (my_rng) )
-      best_state = cur_state;
-
-    // IO
-    if (! ( (i + 1) % poll_intvl) )
+    for (k = (i / swap_intvl) % 2; k + 1 < replicas; k += 2)
     {
-      if (prog_opts["VERBOSE"] == "TRUE")
-      {
-        cout << fixed << scientific << "temperature = " << temp << endl;
-        display_stats (best_state, i + 1);
-      }
+      d = (vec_chain[k].state.health.fitness - vec_chain[k + 1].state.health.fitness) *
+          (1.0 - 1.0 / TEMP_LADDER) / (temp * pow (TEMP_LADDER, k) );
 
-      // Are we done?  If so save the schedule.
-      if (temp < TEMP_MIN)
+      if (d >= 0 || exp (d) > rand_unitintvl (swap_rng) )
       {
-        m_end_time = time (NULL);
-        m_best_fitness = best_state.health.sched;
-        save_scheds (best_state);
-        return;
+        swap (vec_chain[k].state, vec_chain[k + 1].state);
+        swap (vec_chain[k].chkpt, vec_chain[k + 1].chkpt);
       }
     }
+
+    for (k = 1, best = 0; k < replicas; k++)
+      if (vec_chain[k].state.health.fitness < vec_chain[best].state.health.fitness)
+        best = k;
+
+    // IO
+    if (prog_opts["VERBOSE"] == "TRUE" && (i + swap_intvl) / m_poll > i / m_poll)
+    {
+      cout << fixed << scientific << "temperature = " << temp
+           << " (replica " << best << ")" << endl;
+      display_stats (vec_chain[best].state, i + swap_intvl);
+    }
+
+    // Are we done?  If so save the best schedule of any replica.
+    if (stop_run (run, vec_chain[best].state, i + swap_intvl, temp) )
+      break;
   } // End annealing
+
+  rounds.finish();
+
+  for (auto it = vec_thread.begin(); it != vec_thread.end(); it++)
+    it->join();
+
+  m_end_time = sched_clock_t::now();
+
+  if (prog_opts["VERBOSE"] == "TRUE")
+  {
+    cout << "Stopped after " << i + swap_intvl << " iterations: " << run.reason << endl;
+    display_moves (vec_chain);
+  }
+
+  m_best_fitness = vec_chain[best].state.health.sched;
+  save_scheds (vec_chain[best].state);
+}
+
+void Schedule::temper_thread (
+  vector<chain_t>       &vec_chain,
+  int                   first,
+  int                   step,
+  const vector<double>  &vec_temp,
+  rounds_t              &rounds)
+{
+  double ladder;
+  int round = 0;
+
+  while (rounds.next (round) )
+  {
+    for (int k = first; k < static_cast<int> (vec_chain.size() ); k += step)
+    {
+      ladder = pow (TEMP_LADDER, k);
+
+      for (auto it = vec_temp.begin(); it != vec_temp.end(); it++)
+        anneal (vec_chain[k], *it * ladder);
+    }
+
+    rounds.done();
+  }
+}
+
+void Schedule::init_chain (chain_t &chain)
+{
+  chain.seed = m_rng();
+  chain.rng.seed (chain.seed);
+  chain.accepts = 0;
+  chain.state.health.init();
+  chain.state.vec_order.resize (m_vec_crs.size() );
+  chain.state.vec_pos.resize (m_vec_crs.size() );
+  chain.state.vec_slot.resize (m_vec_crs.size() );
+  chain.state.vec_room_crs.assign (m_sym_room.size(), vector<int>() );
+
+  assert (m_vec_crs.size() );
+
+  for (int m = 0; m < MOVES; m++)
+  {
+    chain.move_tries[m] = 0;
+    chain.move_accepts[m] = 0;
+  }
+
+  for (size_t c = 0; c < m_vec_crs.size(); c++)
+  {
+    chain.state.vec_order[c] = static_cast<int> (c);
+    chain.state.vec_pos[c] = static_cast<int> (c);
+    chain.state.vec_slot[c].time = -1;
+    chain.state.vec_slot[c].room = -1;
+    chain.state.vec_slot[c].health.init();
+
+    // Only courses choosing a room score their buffer, the rest add nothing
+    if (m_vec_crs[c].const_room)
+      chain.state.vec_slot[c].health.buf_fitness = 0;
+  }
+
+  // Allocate enough room for the courses
+  chain.cur_state = chain.state;
+}
+
+bool Schedule::anneal (chain_t &chain, double temp)
+{
+  double delta;
+  health_t health;
+  e_move move = pick_move (chain.rng);
+
+  // Local moves change the accepted state in place, so need one to start from
+  if (!chain.chkpt.valid && move != MOVE_FRONT)
+    move = MOVE_SWAP;
+
+  chain.move_tries[move]++;
+
+  if (move != MOVE_SWAP && move != MOVE_FRONT)
+  {
+    if (!local_move (chain, move, temp) )
+      return false;
+
+    chain.move_accepts[move]++;
+    chain.accepts++;
+    return true;
+  }
+
+  // Get a psuedo-random schedule
+  perturb_state (chain.state, health, chain.cur_state, chain.rng, chain.chkpt, move);
+  chain.cur_state.health = health;
+  chain.cur_state.health.fitness = get_score (health, chain.cur_state.vec_order.size() );
+
+  //cur_state.health.fitness = static_cast<int>(cur_state.vec_order.size()) - cur_state.health.sched;
+  delta = chain.cur_state.health.fitness - chain.state.health.fitness;
+
+  /*
+    If schedule is better, use it.  Use a worse schedule if the latter
+    condition hold true to anneal, that is, back out of local minima.
+  */
+  if (delta < 0 || exp (-delta / temp) > rand_unitintvl (chain.rng) )
+  {
+    accept_state (chain.state, chain.cur_state, chain.chkpt);
+    chain.move_accepts[move]++;
+    chain.accepts++;
+    return true;
+  }
+
+  return false;
 }
 
 void Schedule::save_scheds (state_t &state)
 {
   cout << endl;
   vector<course_t>::iterator it;
+  vector<course_t> vec_crs;
+  get_courses (state, vec_crs);
 
   if (state.health.instr_colls)
   {
     cout << "Collisions with instructors scheduled concurrently:" << endl;
 
-    for (it = state.vec_crs.begin(); it != state.vec_crs.end(); it++)
+    for (it = vec_crs.begin(); it != vec_crs.end(); it++)
       if (it->health.instr_colls)
         cout << it->id << endl;
   }
@@ -144,7 +749,7 @@ void Schedule::save_scheds (state_t &state)
   {
     cout << endl << "Collisions with rooms scheduled concurrently:" << endl;
 
-    for (it = state.vec_crs.begin(); it != state.vec_crs.end(); it++)
+    for (it = vec_crs.begin(); it != vec_crs.end(); it++)
       if (it->health.room_colls)
         cout << it->id << ": " << it->room_id << endl;
   }
@@ -153,7 +758,7 @@ void Schedule::save_scheds (state_t &state)
   {
     cout << endl<< "Collisions with avoidances scheduled concurrently:" << endl;
 
-    for (it = state.vec_crs.begin(); it != state.vec_crs.end(); it++)
+    for (it = vec_crs.begin(); it != vec_crs.end(); it++)
       if (it->health.avoid_colls)
         cout << it->id << endl;
   }
@@ -162,7 +767,7 @@ void Schedule::save_scheds (state_t &state)
   {
     cout << endl << "Collisions with instructor blocks:" << endl;
 
-    for (it = state.vec_crs.begin(); it != state.vec_crs.end(); it++)
+    for (it = vec_crs.begin(); it != vec_crs.end(); it++)
       if (it->health.bias_fitness < 0)
         cout << it->id << endl;
   }
@@ -183,31 +788,40 @@ void Schedule::save_scheds (state_t &state)
   bs_t times;
   uint8_t days;
 
-  map<string, Week> mapstr_group;
-  map<string, Week> mapstr_instr;
-  map<string, Week> mapstr_room;
-
-  ofstream failed_scheds;
-  ofstream group_html;
-  ofstream instr_html;
-  ofstream room_html;
-  ofstream saved_scheds;
+  Calendar cal_group (CAL_GROUP);
+  Calendar cal_instr (CAL_INSTR);
+  Calendar cal_room  (CAL_ROOM);
+  Calendar::cell_t *week;
 
-  // stringstream is used for easy and quick string formatting
-  stringstream oss_lects;
-  stringstream oss_times;
-  oss_times.precision (1);
+  outfile_t failed_scheds;
+  outfile_t group_html;
+  outfile_t instr_html;
+  outfile_t room_html;
+  outfile_t saved_scheds;
+  Debug debug;
 
-  if (file_exists ("failed.csv") ||
-      file_exists ("group.html") ||
-      file_exists ("instr.html") ||
-      file_exists ("room.html")  ||
-      file_exists ("scheduled.csv") )
+  if (file_exists (output_path (FILE_FAILED).c_str() )    ||
+      file_exists (output_path (FILE_GROUP_CAL).c_str() ) ||
+      file_exists (output_path (FILE_INSTR_CAL).c_str() ) ||
+      file_exists (output_path (FILE_ROOM_CAL).c_str() )  ||
+      file_exists (output_path (FILE_SCHEDULED).c_str() ) )
   {
-    while (repeat)
+    if (prog_opts["OVERWRITE"] == "NO")
+    {
+      cout << endl << "Existing schedules kept, nothing saved" << endl;
+      return;
+    }
+
+    // Stops at the end of the input as well, so a closed console cannot hang
+    while (repeat && prog_opts["OVERWRITE"] == "ASK")
     {
       cout << endl << "Overwrite existing schedules (y/n)? ";
-      cin >> str_yesno;
+
+      if (! (cin >> str_yesno) )
+      {
+        cout << endl << "Existing schedules kept, nothing saved" << endl;
+        return;
+      }
 
       if (make_upper (str_yesno) == "Y")
         repeat = false;
@@ -217,15 +831,16 @@ void Schedule::save_scheds (state_t &state)
     }
   }
 
-  failed_scheds.open  ("failed.csv");
-  group_html.open     ("group.html");
-  instr_html.open     ("instr.html");
-  room_html.open      ("room.html");
-  saved_scheds.open   ("scheduled.csv");
+  failed_scheds.open  (output_path (FILE_FAILED) );
+  group_html.open     (output_path (FILE_GROUP_CAL) );
+  instr_html.open     (output_path (FILE_INSTR_CAL) );
+  room_html.open      (output_path (FILE_ROOM_CAL) );
+  saved_scheds.open   (output_path (FILE_SCHEDULED) );
   /*
     So that decimals are used in CSV in case the spreadsheet application treats
     time intervals like dates
   */
+  failed_scheds.precision (1);
   saved_scheds.precision (1);
 
   for (auto it = m_mapstr_const_course.begin(); it != m_mapstr_const_course.end(); it++)
@@ -235,25 +850,17 @@ void Schedule::save_scheds (state_t &state)
       as failed, and not output the appropriate CSV
     */
     it->second.health.reset();
-    state.vec_crs.push_back (it->second);
+    vec_crs.push_back (it->second);
   }
 
   /*
-    Indices are built using an array of 7*48=336 m_week_t structures for all
-    groups, instructors, and rooms using the day and time as the index, for
-    example, monday (=1) at 15hrs (=30) = [1 * 48 + 30] for: mapstr_group,
-    mapstr_instr, mapstr_room
+    Weeks of 7*48=336 cells are kept for all groups, instructors, and rooms
+    using the day and time as the index, for example, monday (=1) at 15hrs
+    (=30) = [1 * 48 + 30] for: cal_group, cal_instr, cal_room
   */
-  for (auto it_course = state.vec_crs.begin(); it_course != state.vec_crs.end(); it_course++)
+  for (auto it_course = vec_crs.begin(); it_course != vec_crs.end(); it_course++)
   {
-    oss_lects.str ("");
-    oss_times.str ("");
-
-    if (it_course->lectures)
-      oss_lects << it_course->lectures;
-
-    if (it_course->const_time)
-      oss_times << fixed << it_course->start_time << "-" << it_course->end_time;
+    int crs = static_cast<int> (it_course - vec_crs.begin() );
 
     if (!can_schedule (*it_course) )
     {
@@ -266,15 +873,25 @@ void Schedule::save_scheds (state_t &state)
               ? (it_course->multi_days
                  ? break_days (it_course->vec_days)
                  : flag_to_str (it_course->days) )
-                : "")                                         << ","
-            << oss_times.str()                                << ","
-            << vec_to_str (it_course->vec_instr)               << ","
-            << it_course->room_id                             << ","
-            << it_course->size                                << ","
-            << oss_lects.str()                                << ","
-            << it_course->group                               << ","
-            << vec_to_str (it_course->vec_avoid)
-            << endl;
+                : "")                                         << ",";
+
+      if (it_course->const_time)
+        failed_scheds << it_course->start_time << "-" << it_course->end_time;
+
+      failed_scheds
+          << ","
+          << vec_to_str (it_course->vec_instr)               << ","
+          << it_course->room_id                             << ","
+          << it_course->size                                << ",";
+
+      if (it_course->lectures)
+        failed_scheds << it_course->lectures;
+
+      failed_scheds
+          << ","
+          << it_course->group                               << ","
+          << vec_to_str (it_course->vec_avoid)
+          << "\n";
       continue;
     }
 
@@ -287,7 +904,6 @@ void Schedule::save_scheds (state_t &state)
     room_id     = it_course->room_id;
     group       = it_course->group;
     saved_scheds
-        << fixed
         << id                                               << ","
         << it_course->name                                  << ","
         << it_course->hours                                 << ","
@@ -297,133 +913,319 @@ void Schedule::save_scheds (state_t &state)
         << static_cast<double> ( (start_time + blocks) / 2.0) << ","
         << vec_to_str (it_course->vec_instr)                 << ","
         << room_id                                          << ","
-        << it_course->size                                  << ","
-        << oss_lects.str()                                  << ","
+        << it_course->size                                  << ",";
+
+    if (it_course->lectures)
+      saved_scheds << it_course->lectures;
+
+    saved_scheds
+        << ","
         << group                                            << ","
         << vec_to_str (it_course->vec_avoid)
-        << endl;
+        << "\n";
 
     for (j = 0; j < vec_bitpos_idx[days].size(); j++)
     {
       idx = vec_bitpos_idx[days][j] + start_time;
 
+      // Spanned cells keep their span, as a course may have started there
       for (k = 0; k < it_course->vec_instr.size(); k++)
       {
-        str = it_course->vec_instr[k];
-        mapstr_instr[str].m_week_idx[idx].data = id + "<br>" + room_id;
-        mapstr_instr[str].m_week_idx[idx].span = blocks;
-      }
+        week = cal_instr.week (it_course->vec_instr[k]);
+        week[idx].crs  = crs;
+        week[idx].span = blocks;
 
-      if (room_id != "")
-      {
-        mapstr_room[room_id].m_week_idx[idx].data =
-          break_instr (it_course->vec_instr) + id;
-        mapstr_room[room_id].m_week_idx[idx].span = blocks;
+        for (l = 1; l < blocks; l++)
+          week[idx + l].crs = Calendar::CELL_SPAN;
       }
 
-      for (k = 1; k < blocks; k++)
+      if (room_id != "")
       {
-        for (l = 0; l < it_course->vec_instr.size(); l++)
-          mapstr_instr[it_course->vec_instr[l]].m_week_idx[idx + k].data = "SPAN";
+        week = cal_room.week (room_id);
+        week[idx].crs  = crs;
+        week[idx].span = blocks;
 
-        if (room_id != "")
-          mapstr_room[room_id].m_week_idx[idx + k].data = "SPAN";
+        for (l = 1; l < blocks; l++)
+          week[idx + l].crs = Calendar::CELL_SPAN;
       }
     }
 
     for (l = 0; l < token_count (group, ":"); l++)
     {
-      str = get_token (group, l, ":");
+      week = cal_group.week (get_token (group, l, ":") );
 
       for (j = 0; j < vec_bitpos_idx[days].size(); j++)
       {
         idx = vec_bitpos_idx[days][j] + start_time;
-        mapstr_group[str].m_week_idx[idx].data =
-          break_instr (it_course->vec_instr) + id + "<br>" + room_id;
-        mapstr_group[str].m_week_idx[idx].span = blocks;
+        week[idx].crs  = crs;
+        week[idx].span = blocks;
 
         for (k = 1; k < blocks; k++)
-          mapstr_group[str].m_week_idx[idx + k].data = "SPAN";
+          week[idx + k].crs = Calendar::CELL_SPAN;
+      }
+    }
+  }
+
+  int threads = atoi (prog_opts["THREADS"].c_str() );
+
+  if (threads < 1)
+    threads = max (1, static_cast<int> (thread::hardware_concurrency() ) );
+
+  // The three files are written at once, each sharing out the tables of its calendar
+  threads = max (1, threads / 3);
+
+  thread group_thread (&Schedule::write_html, this, ref (group_html), cref (cal_group), cref (vec_crs), threads);
+  thread instr_thread (&Schedule::write_html, this, ref (instr_html), cref (cal_instr), cref (vec_crs), threads);
+  write_html (room_html, cal_room, vec_crs, threads);
+
+  group_thread.join();
+  instr_thread.join();
+
+  /*
+    Every file is on disk before any replaces the file of an earlier run, and
+    each is renamed into place whole, so none is seen half written.  The files
+    are replaced one at a time though, so a reader can still get old ones mixed
+    with new.  The manifest is removed first and written last, and a reader
+    that wants a matching set checks each file it read against the size and
+    hash listed there.
+  */
+  outfile_t *vec_file[] = { &failed_scheds, &group_html, &instr_html, &room_html, &saved_scheds };
+  const string *vec_name[] = { &FILE_FAILED, &FILE_GROUP_CAL, &FILE_INSTR_CAL, &FILE_ROOM_CAL, &FILE_SCHEDULED };
+  bool written = true;
+
+  for (j = 0; j < 5; j++)
+  {
+    if (!vec_file[j]->close() )
+    {
+      debug.push_error ("Unable to write " + output_path (*vec_name[j]) );
+      written = false;
+    }
+  }
+
+  if (written)
+  {
+    remove (output_path (FILE_MANIFEST).c_str() );
+
+    for (j = 0; j < 5; j++)
+    {
+      if (!vec_file[j]->commit() )
+      {
+        debug.push_error ("Unable to replace " + output_path (*vec_name[j]) );
+        written = false;
       }
     }
   }
 
-  write_html (group_html, mapstr_group);
-  write_html (instr_html, mapstr_instr);
-  write_html (room_html, mapstr_room);
+  if (written && !write_manifest (state, vec_file, vec_name, 5) )
+    debug.push_error ("Unable to write " + output_path (FILE_MANIFEST) );
+
+  // Nothing is left behind by live_or_die, which does not return on an error
+  for (j = 0; j < 5; j++)
+    vec_file[j]->discard();
+
+  debug.live_or_die();
+  m_saved = true;
 
   if (prog_opts["VERBOSE"] == "TRUE")
     cout << endl << "Schedules saved!" << endl << endl;
-
-  group_html.close();
-  instr_html.close();
-  room_html.close();
 }
 
-void Schedule::write_html (ofstream &file, map<string, Week> &mapstr_cal)
+bool Schedule::write_manifest (
+  const state_t                   &state,
+  outfile_t                       *vec_file[],
+  const string                    *vec_name[],
+  int                             files)
 {
-  int idx;
-  int span;
-  int time;
+  char finished[32];
+  time_t now = time (NULL);
+  strftime (finished, sizeof (finished), "%Y-%m-%d %H:%M:%S", localtime (&now) );
 
-  string member;
-  string str;
+  outfile_t manifest;
   stringstream oss;
 
+  if (!manifest.open (output_path (FILE_MANIFEST) ) )
+    return false;
+
+  manifest.precision (2);
+  manifest
+      << "# written by sacs once every file listed is complete\n"
+      << "# file = bytes fnv-1a\n"
+      << "compiled = " << COMPILE_DATE << " " << COMPILE_TIME << "\n"
+      << "finished = " << finished << "\n"
+      << "seconds = " << duration() << "\n"
+      << "courses = " << state.vec_order.size() << "\n"
+      << "scheduled = " << state.health.sched << "\n";
+
+  for (int i = 0; i < files; i++)
+  {
+    oss << hex << setw (16) << setfill ('0') << vec_file[i]->hash();
+    manifest << *vec_name[i] << " = " << vec_file[i]->bytes() << " " << oss.str() << "\n";
+    oss.str ("");
+  }
+
+  return manifest.close() && manifest.commit();
+}
+
+Schedule::Calendar::cell_t *Schedule::Calendar::week (const string &member)
+{
+  auto it = m_mapstr_week.find (member);
+
+  if (it == m_mapstr_week.end() )
+  {
+    it = m_mapstr_week.insert (make_pair (member, m_vec_cell.size() ) ).first;
+    m_vec_cell.resize (m_vec_cell.size() + 336);
+
+    for (size_t i = it->second; i < m_vec_cell.size(); i++)
+    {
+      m_vec_cell[i].crs  = CELL_EMPTY;
+      m_vec_cell[i].span = 0;
+    }
+  }
+
+  return &m_vec_cell[it->second];
+}
+
+void Schedule::write_html (
+  outfile_t                       &file,
+  const Calendar                  &cal,
+  const vector<course_t>          &vec_crs,
+  int                             threads)
+{
   for (auto it = m_vec_header.begin(); it != m_vec_header.end(); it++)
-    file << *it << endl;
-
-  for (auto it = mapstr_cal.begin(); it != mapstr_cal.end(); it++)
-  {
-    member = it->first;
-    file
-        << "<h1>" << member << "</h1>\n"
-        << "<table>\n"
-        << "  <tr>\n"
-        << "    <th>Time</th>\n"
-        << "    <th>Monday</th>\n"
-        << "    <th>Tuesday</th>\n"
-        << "    <th>Wednesday</th>\n"
-        << "    <th>Thursday</th>\n"
-        << "    <th>Friday</th>\n"
-        << "  </tr>\n";
+    file << *it << "\n";
+
+  /*
+    Each thread renders the tables of a run of members into its own string,
+    and the strings are written in order, so the file is the same whatever the
+    number of threads
+  */
+  int members = static_cast<int> (cal.m_mapstr_week.size() );
+  threads = max (1, min (threads, members / HTML_CHUNK) );
+
+  vector<string> vec_str (threads);
+  vector<thread> vec_thread;
+  auto first = cal.m_mapstr_week.begin();
+
+  for (int t = 0; t < threads; t++)
+  {
+    auto last = next (first, members * (t + 1) / threads - members * t / threads);
+    vec_thread.push_back (thread (&Schedule::render_html, this, ref (vec_str[t]), cref (cal), cref (vec_crs), first, last) );
+    first = last;
+  }
+
+  for (int t = 0; t < threads; t++)
+  {
+    vec_thread[t].join();
+    file << vec_str[t];
+  }
+
+  file << "</body>\n</html>\n";
+}
+
+void Schedule::render_html (
+  string                                  &str,
+  const Calendar                          &cal,
+  const vector<course_t>                  &vec_crs,
+  map<string, size_t>::const_iterator     first,
+  map<string, size_t>::const_iterator     last) const
+{
+  int idx;
+  int time;
+
+  for (auto it = first; it != last; it++)
+  {
+    const Calendar::cell_t *week = &cal.m_vec_cell[it->second];
+
+    str +=
+      "<h1>" + it->first + "</h1>\n"
+      "<table>\n"
+      "  <tr>\n"
+      "    <th>Time</th>\n"
+      "    <th>Monday</th>\n"
+      "    <th>Tuesday</th>\n"
+      "    <th>Wednesday</th>\n"
+      "    <th>Thursday</th>\n"
+      "    <th>Friday</th>\n"
+      "  </tr>\n";
 
     for (int i = 0; i < 26; i++)
     {
       if ( (time = 8 + ( i / 2) ) > 12)
         time -= 12;
 
-      oss << time << ":" << (i % 2 ? "30" : "00");
-      file << "  <tr>\n    <td>" << oss.str() << "</td>\n";
-      oss.str ("");
+      str += "  <tr>\n    <td>";
+      append_int (str, time);
+      str += i % 2 ? ":30</td>\n" : ":00</td>\n";
 
       for (int j = 1; j < 6; j++)
       {
         idx = vec_bitpos_idx[1 << j][0] + 16 + i;
-        str  = mapstr_cal[member].m_week_idx[idx].data;
-        span = mapstr_cal[member].m_week_idx[idx].span;
+        const Calendar::cell_t &cell = week[idx];
 
-        if (span)
-          file << "    <td rowspan=\"" << span << "\">" << str << "</td>\n";
+        if (cell.span)
+        {
+          str += "    <td rowspan=\"";
+          append_int (str, cell.span);
+          str += "\">";
 
-        else if (str != "SPAN")
-          file << "    <td></td>\n";
+          if (cell.crs == Calendar::CELL_SPAN)
+            str += "SPAN";
+
+          else if (cell.crs != Calendar::CELL_EMPTY)
+          {
+            const course_t &course = vec_crs[cell.crs];
+
+            if (cal.m_kind != CAL_INSTR)
+              str += break_instr (course.vec_instr);
+
+            str += course.id;
+
+            if (cal.m_kind != CAL_ROOM)
+              str += "<br>" + course.room_id;
+          }
+
+          str += "</td>\n";
+        }
+
+        else if (cell.crs != Calendar::CELL_SPAN)
+          str += "    <td></td>\n";
       }
 
-      file << "  </tr>\n";
+      str += "  </tr>\n";
     }
 
-    file << "</table>\n\n<p style=\"page-break-before: always\"></p>\n\n";
+    str += "</table>\n\n<p style=\"page-break-before: always\"></p>\n\n";
   }
-
-  file << "</body>\n</html>\n";
 }
 
-int Schedule::duration()
+double Schedule::duration()
 {
-  return static_cast<int> (difftime (m_end_time, m_start_time) );
+  return chrono::duration<double> (m_end_time - m_start_time).count();
 };
 
+void Schedule::get_courses (const state_t &state, vector<course_t> &vec_crs)
+{
+  course_t course;
+
+  for (auto it = state.vec_order.begin(); it != state.vec_order.end(); it++)
+  {
+    const slot_t &slot = state.vec_slot[*it];
+    course = m_vec_crs[*it];
+
+    if (slot.time >= 0)
+      course.bs_sched = course.vec_avail_times[slot.time];
+
+    if (slot.room >= 0)
+    {
+      course.room_id  = course.vec_prooms[slot.room].id;
+      course.room_sym = course.vec_prooms[slot.room].sym;
+    }
+
+    course.health = slot.health;
+    vec_crs.push_back (course);
+  }
+}
+
 void Schedule::display_stats (const state_t &state, int iter)
 {
   cout << "iteration = " << setw (6) << right << iter
@@ -432,51 +1234,91 @@ void Schedule::display_stats (const state_t &state, int iter)
        << "  e = " << setw (3) << state.health.elec_colls
        << "  i = " << setw (3) << state.health.instr_colls
        << "  r = " << setw (3) << state.health.room_colls << " )"
-       << " ( " << state.health.sched << " / " << state.vec_crs.size() << " )"
+       << " ( " << state.health.sched << " / " << state.vec_order.size() << " )"
        << endl << endl;
 }
 
+void Schedule::display_graph()
+{
+  graph_stats_t stats;
+  graph_stats (m_graph, stats);
+
+  cout << "Conflict graph:" << endl
+       << setw (36) << left << "  courses: " << m_graph.size() << endl
+       << setw (36) << left << "  edges: " << stats.edges << endl
+       << setw (36) << left << "  hard edges: " << stats.hard_edges << endl
+       << setw (36) << left << "  degree min / mean / max: "
+       << stats.min_degree << " / " << fixed << setprecision (1) << stats.mean_degree << " / " << stats.max_degree << endl
+       << setw (36) << left << "  greatest weighted degree: " << stats.max_weight << endl
+       << setw (36) << left << "  largest clique found / bound: " << stats.clique << " / " << stats.clique_bound << endl
+       << "  degree histogram:" << endl;
+
+  for (size_t b = 0; b < stats.vec_degree_hist.size(); b++)
+  {
+    ostringstream oss;
+
+    if (b < 2)
+      oss << b;
+    else
+      oss << (1 << (b - 1) ) << "-" << (1 << b) - 1;
+
+    cout << "    " << setw (12) << right << oss.str() << setw (8) << stats.vec_degree_hist[b] << endl;
+  }
+
+  cout << left << endl;
+}
+
 void Schedule::get_bitsched (
-  course_t              &course,
-  map<string, bs_t>     &u_crs_idx,
-  map<string, bs_t>     &u_instr_idx,
-  map<string, bs_t>     &u_room_idx)
+  const course_t        &course,
+  slot_t                &slot,
+  uidx_t                &uidx)
 {
-  int i, j;
+  int i;
   int avoid_colls;
   int elec_colls;
   int instr_colls;
   int room_colls;
+  int room = room_sym (course, slot);
+  int n = static_cast<int> (course.vec_avail_times.size() );
 
   bs_t bs;
 
   pfit_t pfit;
   pfit_t best_pfit;
-
-  string str;
   best_pfit.health.init();
+  slot.time = -1;
 
-  // vec_avail_times was computed when we grabbed the course entry from courses.csv
-  for (i = 0; i < course.vec_avail_times.size(); i++)
-  {
-    avoid_colls = 0;
-    elec_colls  = 0;
-    instr_colls = 0;
-    room_colls  = 0;
-    bs = course.vec_avail_times[i];
+  // Collision counts for every candidate: avoid, elec, instr, room
+  static thread_local vector<int> vec_colls;
+  vec_colls.assign (4 * n, 0);
+
+  int *avoid = &vec_colls[0];
+  int *elec  = avoid + n;
+  int *instr = elec + n;
+  int *rooms = instr + n;
 
-    // Calculate avoidance collisions
-    for (auto it = course.vec_avoid.begin(); it != course.vec_avoid.end(); it++)
-      avoid_colls += num_conflicts (u_crs_idx[*it] & bs);
+  /*
+    vec_avail_times was computed when we grabbed the course entry from
+    courses.csv.  Collisions are counted for all candidates at once using the
+    scorer selected by score_init.
+  */
+  const bs_t *cand = &course.vec_avail_times[0];
 
-    for (auto it = course.vec_elec.begin(); it != course.vec_elec.end(); it++)
-      elec_colls += num_conflicts (u_crs_idx[*it] & bs);
+  // Calculate avoidance collisions
+  add_conflicts (cand, n, uidx.crs.data(), course.vec_avoid_sym.data(), static_cast<int> (course.vec_avoid_sym.size() ), avoid);
+  add_conflicts (cand, n, uidx.crs.data(), course.vec_elec_sym.data(), static_cast<int> (course.vec_elec_sym.size() ), elec);
+  add_conflicts (cand, n, uidx.room.data(), &room, 1, rooms);
 
-    room_colls += num_conflicts (u_room_idx[course.room_id] & bs);
+  // Calculate instructor collisions
+  add_conflicts (cand, n, uidx.instr.data(), course.vec_instr_sym.data(), static_cast<int> (course.vec_instr_sym.size() ), instr);
 
-    // Calculate instructor collisions
-    for (auto it = course.vec_instr.begin(); it != course.vec_instr.end(); it++)
-      instr_colls += num_conflicts (u_instr_idx[*it] & bs);
+  for (i = 0; i < n; i++)
+  {
+    avoid_colls = avoid[i];
+    elec_colls  = elec[i];
+    instr_colls = instr[i];
+    room_colls  = rooms[i];
+    bs = course.vec_avail_times[i];
 
     pfit.bs = bs;
     pfit.health.avoid_colls = avoid_colls;
@@ -488,105 +1330,148 @@ void Schedule::get_bitsched (
                               CMUL_INSTR * instr_colls +
                               CMUL_ROOM  * room_colls;
 
+    // Blocked times are only chosen if every time is blocked
+    if (course.vec_bias[i] < 0)
+      pfit.health.fitness += CMUL_VOID;
+
     // Here is where we track the best fitting schedule for this course
     if (pfit.health.fitness < best_pfit.health.fitness)
+    {
       best_pfit = pfit;
+      slot.time = i;
+    }
   }
 
-  course.bs_sched = best_pfit.bs;
-  course.health.avoid_colls = best_pfit.health.avoid_colls;
-  course.health.elec_colls  = best_pfit.health.elec_colls;
-  course.health.instr_colls = best_pfit.health.instr_colls;
-  course.health.room_colls  = best_pfit.health.room_colls;
+  slot.health.avoid_colls = best_pfit.health.avoid_colls;
+  slot.health.elec_colls  = best_pfit.health.elec_colls;
+  slot.health.instr_colls = best_pfit.health.instr_colls;
+  slot.health.room_colls  = best_pfit.health.room_colls;
 
   // Update universal indices of the new schedule
-  u_crs_idx[course.name] |= course.bs_sched;
-  u_room_idx[course.room_id] |= course.bs_sched;
-
-  for (j = 0; j < course.vec_instr.size(); j++)
-    u_instr_idx[course.vec_instr[j]] |= course.bs_sched;
+  uidx.push (course, best_pfit.bs, room);
 }
 
 void Schedule::perturb_state (
   const state_t         &const_state,
   health_t              &health,
-  vector<course_t>      &cur_state,
-  prng_t                &my_rng)
+  state_t               &cur_state,
+  prng_t                &my_rng,
+  chkpt_t               &chkpt,
+  e_move                move)
 {
-  course_t course;
-
-  int i, j;
+  int c;
+  int i, j, k;
+  int first;
   int idx;
-  int room_buf = atoi (prog_opts["BUFFER"].c_str() );
+  int p;
   bs_t bs;
 
-  // So we can indirectly manipulate a const parameter
-  state_t state = const_state;
   /*
     Swap two random courses from their positions in the vector.  This maintains
     simular energy levels while perturbing which is one of the requirements of
     simulated annealing.
   */
-  size_t size = state.vec_crs.size();
-  i = my_rng() % size;
-  j = my_rng() % size;
+  int size = static_cast<int> (const_state.vec_order.size() );
 
-  while (j == i)
+  // Or move a course that cannot be scheduled from position i to the front
+  if (move == MOVE_FRONT)
   {
+    i = const_state.vec_pos[pick_course (const_state, my_rng)];
+    j = 0;
+  }
+  else
+  {
+    i = my_rng() % size;
     j = my_rng() % size;
+
+    while (j == i)
+    {
+      j = my_rng() % size;
+    }
   }
 
-  swap (state.vec_crs[i], state.vec_crs[j]);
   // End swap
-  /*
-    Indices used to track what has already been scheduled.  To update the
-    indices, elements are simply bitwise ORed ontop of whatever else is there.
+  if (chkpt.vec_uidx.empty() )
+  {
+    chkpt.stride = max (1, static_cast<int> (sqrt (static_cast<double> (size) ) ) );
+    chkpt.vec_health.resize ( (size - 1) / chkpt.stride + 1);
+    chkpt.vec_next_health.resize (chkpt.vec_health.size() );
+    chkpt.vec_uidx.resize (chkpt.vec_health.size() );
+    chkpt.vec_next_uidx.resize (chkpt.vec_health.size() );
+    chkpt.vec_health[0].reset();
+    chkpt.vec_uidx[0] = m_const_uidx;
+  }
 
-    u_crs_idx["WEBER"] |= bit schedule
+  /*
+    Courses before the first swapped position are scheduled the same as in
+    const_state, so they are replayed from the nearest checkpoint rather than
+    rescheduled.  Checkpoints made stale by local moves are retaken on the way.
   */
-  map<string, bs_t> u_crs_idx;
-  map<string, bs_t> u_instr_idx;
-  map<string, bs_t> u_room_idx;
+  first = chkpt.valid && m_incremental ? min (i, j) : 0;
+  k = min (first, chkpt.stale) / chkpt.stride;
 
-  // Set constants for room and instructor times in indices
-  for (auto it_course = m_mapstr_const_course.begin(); it_course != m_mapstr_const_course.end(); it_course++)
-  {
-    if (it_course->second.room_id != "")
-      u_room_idx[it_course->second.room_id] |= it_course->second.bs_sched;
+  uidx_t &uidx = chkpt.uidx;
+  uidx = chkpt.vec_uidx[k];
+  health = chkpt.vec_health[k];
 
-    for (auto it_instr = it_course->second.vec_instr.begin(); it_instr != it_course->second.vec_instr.end(); it_instr++)
-      u_instr_idx[*it_instr] |= it_course->second.bs_sched;
+  for (p = k * chkpt.stride; p < first; p++)
+  {
+    if (! (p % chkpt.stride) && p > k * chkpt.stride)
+    {
+      chkpt.vec_next_uidx[p / chkpt.stride] = uidx;
+      chkpt.vec_next_health[p / chkpt.stride] = health;
+    }
 
-    u_crs_idx[it_course->second.name] |= it_course->second.bs_sched;
+    c = const_state.vec_order[p];
+    const slot_t &slot = const_state.vec_slot[c];
+    uidx.push (m_vec_crs[c], m_vec_crs[c].vec_avail_times[slot.time], room_sym (m_vec_crs[c], slot) );
+    add_health (health, m_vec_crs[c], slot);
   }
 
-  for (i = 0; i < state.vec_crs.size(); i++)
+  for (p = first; p < size; p++)
   {
-    course = state.vec_crs[i];
+    if (move == MOVE_FRONT)
+      c = const_state.vec_order[p == 0 ? i : p <= i ? p - 1 : p];
+
+    else if (p == i)
+      c = const_state.vec_order[j];
+
+    else if (p == j)
+      c = const_state.vec_order[i];
+
+    else
+      c = const_state.vec_order[p];
+
+    const course_t &course = m_vec_crs[c];
+    slot_t &slot = cur_state.vec_slot[c];
+    slot = const_state.vec_slot[c];
+    cur_state.vec_order[p] = c;
+    cur_state.vec_pos[c] = p;
+
+    if (! (p % chkpt.stride) )
+    {
+      chkpt.vec_next_uidx[p / chkpt.stride] = uidx;
+      chkpt.vec_next_health[p / chkpt.stride] = health;
+    }
 
     // Get random room
     if (!course.const_room)
     {
       idx = my_rng() % course.vec_prooms.size();
 
-      if (course.vec_prooms[idx].id != course.room_id)
+      if (idx != slot.room)
       {
-        course.room_id = course.vec_prooms[idx].id;
-        course.health.buf_fitness = abs (room_buf - (course.vec_prooms[idx].size - course.size) );
+        slot.room = idx;
+        slot.health.buf_fitness = abs (m_room_buf - (course.vec_prooms[idx].size - course.size) );
       }
     }
 
     // Get a schedule for this course with the minimum number of conflicts
-    get_bitsched (course, u_crs_idx, u_instr_idx, u_room_idx);
-    course.health.bias_fitness = 0;
+    get_bitsched (course, slot, uidx);
+    bs = course.vec_avail_times[slot.time];
 
-    // Check instructor perferences, aversions, and blocks
-    for (auto it = course.vec_instr.begin(); it != course.vec_instr.end(); it++)
-      course.health.bias_fitness += get_bias (*it, course.bs_sched);
-
-    // Check for global blocks
-    if (get_bias ("ALL", course.bs_sched) == SCORE_VOID)
-      course.health.bias_fitness += SCORE_VOID;
+    // Instructor perferences, aversions, and blocks, and global blocks
+    slot.health.bias_fitness = course.vec_bias[slot.time];
 
     // Sanity check!
     assert (course.hours > 0);
@@ -594,25 +1479,59 @@ void Schedule::perturb_state (
     assert (course.id != "");
     assert (course.lectures == 0 || ( (course.lectures == 2 || course.lectures == 3) && course.hours == 3) );
     assert (course.name != "");
-    assert (course.room_id != "");
-    assert ( (course.bs_sched & MASK_DAY).any() );
-    assert ( (course.bs_sched & MASK_TIME).any() );
-    assert ( (course.bs_sched & VALID_MASK).none() );
+    assert (room_sym (course, slot) >= 0);
+    assert ( (bs & MASK_DAY).any() );
+    assert ( (bs & MASK_TIME).any() );
+    assert ( (bs & VALID_MASK).none() );
     assert (course.vec_avail_times.size() );
     assert (course.vec_instr.size() );
     assert (course.const_room || (!course.const_room && course.vec_prooms.size() ) );
+    assert (slot.health.buf_fitness >= 0 && slot.health.buf_fitness < INF);
 
     // Update health
-    health.avoid_colls  += course.health.avoid_colls;
-    health.bias_fitness += course.health.bias_fitness;
-    health.buf_fitness  += course.health.buf_fitness;
-    health.elec_colls   += course.health.elec_colls;
-    health.instr_colls  += course.health.instr_colls;
-    health.late_penalty += ( (course.bs_sched & MASK_TIME) >> 16).to_ulong();
-    health.room_colls   += course.health.room_colls;
-    health.sched        += can_schedule (course) ? 1 : 0;
-
-    // Save course with updated bit schedule and health
-    cur_state[i] = course;
+    add_health (health, course, slot);
+    assert (health.buf_fitness >= 0 && health.buf_fitness < INF);
   }
+
+  chkpt.first = first;
+  chkpt.retake = k + 1;
+}
+
+void Schedule::accept_state (
+  state_t               &state,
+  const state_t         &cur_state,
+  chkpt_t               &chkpt)
+{
+  int c;
+  int from;
+  int to;
+
+  state.health = cur_state.health;
+
+  for (size_t p = chkpt.first; p < state.vec_order.size(); p++)
+  {
+    c = cur_state.vec_order[p];
+    const course_t &course = m_vec_crs[c];
+    slot_t &slot = state.vec_slot[c];
+
+    from = slot.time < 0 ? -1 : room_sym (course, slot);
+    to   = room_sym (course, cur_state.vec_slot[c]);
+
+    if (from != to)
+      move_room (state, c, from, to);
+
+    state.vec_order[p] = c;
+    state.vec_pos[c] = static_cast<int> (p);
+    slot = cur_state.vec_slot[c];
+  }
+
+  // Checkpoints after the one perturb_state started from were retaken
+  for (size_t k = chkpt.retake; k < chkpt.vec_uidx.size(); k++)
+  {
+    swap (chkpt.vec_uidx[k], chkpt.vec_next_uidx[k]);
+    swap (chkpt.vec_health[k], chkpt.vec_next_health[k]);
+  }
+
+  chkpt.stale = INF;
+  chkpt.valid = true;
 }
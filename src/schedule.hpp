@@ -20,14 +20,174 @@
 #if !defined(SCHEDULE_HPP)
 #define SCHEDULE_HPP
 
+#include <atomic>
 #include <cassert>
-#include <fstream>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <vector>
 
 #include "course.hpp"
 #include "debug.hpp"
+#include "graph.hpp"
+#include "mapfile.hpp"
+#include "outfile.hpp"
 #include "utility.hpp"
 
+/*! Monotonic clock used to time optimization and enforce TIME-LIMIT */
+typedef std::chrono::steady_clock sched_clock_t;
+
+/*!
+  Cooling schedules selected by COOLING.  Each but ADAPTIVE cools from the
+  initial temperature to TEMP_MIN over the length of the run:
+
+    GEOMETRIC:   temp falls by REDUCTION every iteration
+    LINEAR:      temp falls by the same amount every iteration
+    LOG:         1 / temp rises with the log of the iteration
+    LUNDY_MEES:  1 / temp rises by the same amount every iteration
+    ADAPTIVE:    temp falls or rises by REDUCTION to keep the ratio of
+                 accepted states near a target that falls over the run
+*/
+enum e_cooling
+{
+  GEOMETRIC, LINEAR, LOG, LUNDY_MEES, ADAPTIVE
+};
+
+/*!
+  What a calendar written by Schedule::write_html is kept for, which decides
+  the text of its cells:
+
+    CAL_GROUP:  instructors, course, and room
+    CAL_INSTR:  course and room
+    CAL_ROOM:   instructors and course
+*/
+enum e_cal
+{
+  CAL_GROUP, CAL_INSTR, CAL_ROOM
+};
+
+/*!
+  Progress of a single annealing run, used by Schedule::stop_run to decide
+  when to stop and by Schedule::cool to lower the temperature:
+
+  double time_limit:
+    seconds the run may take, 0 for no limit
+
+  double temp_init:
+    the temperature of the first iteration, TEMP-INIT or calibrated
+
+  double length:
+    the number of iterations over which the run cools to TEMP_MIN.  Without a
+    time or iteration limit it is the number GEOMETRIC cooling takes, otherwise
+    it is reset on every iteration so that the run cools as the limit runs out.
+
+  double accept_ratio:
+    moving average of the ratio of accepted states, for ADAPTIVE
+
+  double best_fitness, int best_iter:
+    the best fitness seen and the iteration it was first seen, for STAGNATION
+
+  const char *reason:
+    why the run stopped
+*/
+struct run_t
+{
+  sched_clock_t::time_point start;
+
+  double time_limit;
+  double temp_init;
+  double length;
+  double accept_ratio;
+  double best_fitness;
+
+  int best_iter;
+
+  const char *reason;
+};
+
+/*!
+  Rounds of Schedule::temper, run by worker threads that live as long as the
+  run does.  The main thread starts a round with start and waits in wait until
+  every worker has called done; stop tells the workers to return.
+
+  int round:
+    rounds started so far, a worker waits in next for a round it has not run
+
+  int running, workers:
+    workers still running the current round, and workers in all
+*/
+struct rounds_t
+{
+  std::mutex mutex;
+  std::condition_variable cv_start;
+  std::condition_variable cv_done;
+
+  int round   = 0;
+  int running = 0;
+  int workers = 0;
+  bool stop   = false;
+
+  /*! Starts the next round on every worker */
+  void start()
+  {
+    {
+      std::lock_guard<std::mutex> lock (mutex);
+      round++;
+      running = workers;
+    }
+
+    cv_start.notify_all();
+  }
+
+  /*! Waits for every worker to finish the round */
+  void wait()
+  {
+    std::unique_lock<std::mutex> lock (mutex);
+    cv_done.wait (lock, [this] { return running == 0; } );
+  }
+
+  /*! Tells the workers to return once the current round is done */
+  void finish()
+  {
+    {
+      std::lock_guard<std::mutex> lock (mutex);
+      stop = true;
+    }
+
+    cv_start.notify_all();
+  }
+
+  /*!
+    Called by a worker that last ran round last.  Waits for a new round and
+    sets last to it, or returns false once told to stop.
+  */
+  bool next (int &last)
+  {
+    std::unique_lock<std::mutex> lock (mutex);
+    cv_start.wait (lock, [&] { return stop || round != last; } );
+
+    if (stop)
+      return false;
+
+    last = round;
+    return true;
+  }
+
+  /*! Called by a worker that finished its round */
+  void done()
+  {
+    bool last;
+
+    {
+      std::lock_guard<std::mutex> lock (mutex);
+      last = --running == 0;
+    }
+
+    if (last)
+      cv_done.notify_one();
+  }
+};
+
 /*!
   Schedule::optimize is where the program spends most of its time.  Optimization
   is done through simulated annealing.  The starting and ending temperatures are
@@ -55,6 +215,10 @@ public:
     not found, as error is output to debug.log and the console before the
     program exits.
 
+    The problem is then read from the CSVs, or from FILE_SNAPSHOT if SNAPSHOT
+    is LOAD and the snapshot is up to date.  The snapshot is written when
+    SNAPSHOT is COMPILE, or LOAD and it was out of date.
+
     Seeds random number generator with the current time.
   */
   Schedule();
@@ -62,57 +226,94 @@ public:
   /*!
     The possible bit schedules are looked at and a score for each is calculated
     for each depending on the number of conflicts ascertained from checking the
-    u indices.
+    u indices.  The best is saved to slot.  Times blocked by course.vec_bias
+    are only chosen if every time is blocked.
   */
   void get_bitsched (
-    course_t                        &const_course,
-    std::map<std::string, bs_t>     &u_crs_idx,
-    std::map<std::string, bs_t>     &u_instr_idx,
-    std::map<std::string, bs_t>     &u_room_idx);
+    const course_t                  &course,
+    slot_t                          &slot,
+    uidx_t                          &uidx);
 
   /*!
     Function is called from optimize to schedule all courses in state.
     health is non-const so as to be overwritten, the same for cur_state.
     my_rng is another remnant from when the program was threaded and all
     threads had a different random number generator.
+
+    With INCREMENTAL set, only the courses from the first swapped position
+    onward are rescheduled, starting from the nearest checkpoint in chkpt.
+    Positions of cur_state before chkpt.first, and the slots of the courses in
+    them, are left untouched.
+
+    move is MOVE_SWAP or MOVE_FRONT.
   */
   void perturb_state (
     const state_t                   &state,
     health_t                        &health,
-    std::vector<course_t>           &cur_state,
-    prng_t                          &my_rng);
+    state_t                         &cur_state,
+    prng_t                          &my_rng,
+    chkpt_t                         &chkpt,
+    e_move                          move = MOVE_SWAP);
+
+  /*!
+    Copies the positions rescheduled by perturb_state from cur_state to state,
+    along with the slots of the courses in them and the checkpoints taken.
+  */
+  void accept_state (
+    state_t                         &state,
+    const state_t                   &cur_state,
+    chkpt_t                         &chkpt);
 
-  /*! HACK: For use in outputting schedules to HTML */
-  class Week
+  /*!
+    For use in outputting schedules to HTML: a week of 7*48=336 half hour cells
+    for each group, instructor, or room, kept one after the other in m_vec_cell.
+    A cell holds the index of the course starting in it and the number of cells
+    the course spans, or CELL_SPAN in the cells it spans after the first.  Text
+    is only made for a cell when write_html writes it.
+  */
+  class Calendar
   {
   public:
-    Week()
+    Calendar (e_cal kind) : m_kind (kind) {};
+
+    struct cell_t
     {
-      for (int i = 0; i < 336; i++)
-      {
-        m_week_idx[i].span = 0;
-        m_week_idx[i].data = "";
-      }
+      int32_t crs  : 24;
+      int32_t span : 8;
     };
 
-    struct m_week_t
-    {
-      int span;
-      std::string data;
-    } m_week_idx[336];
+    /*! Cell holds no course */
+    static const int CELL_EMPTY = -1;
+
+    /*! Cell is spanned by the course started in a cell above it */
+    static const int CELL_SPAN  = -2;
+
+    /*! Returns the 336 cells of member, empty when first asked for */
+    cell_t *week (const std::string &member);
+
+    e_cal m_kind;
+
+    /*! Index into m_vec_cell of the first cell of each member */
+    std::map<std::string, size_t> m_mapstr_week;
+    std::vector<cell_t> m_vec_cell;
   };
 
   /*!
     Returns true if the course is schedule-able given the number of collisions
     and the bias fitness score.
   */
-  bool can_schedule (const course_t &course)
+  bool can_schedule (const health_t &health)
   {
     return
-      ! (course.health.avoid_colls  ||
-         course.health.instr_colls  ||
-         course.health.room_colls   ||
-         course.health.bias_fitness < 0);
+      ! (health.avoid_colls  ||
+         health.instr_colls  ||
+         health.room_colls   ||
+         health.bias_fitness < 0);
+  };
+
+  bool can_schedule (const course_t &course)
+  {
+    return can_schedule (course.health);
   };
 
   int best()
@@ -120,14 +321,52 @@ public:
     return m_best_fitness;
   };
 
+  /*! Whether save_scheds wrote the schedules */
+  bool saved()
+  {
+    return m_saved;
+  };
+
   void reset()
   {
     m_best_fitness = 0;
   };
 
+  /*! Adds the health of a scheduled course to the health of a state */
+  void add_health (health_t &health, const course_t &course, const slot_t &slot)
+  {
+    health.avoid_colls  += slot.health.avoid_colls;
+    health.bias_fitness += slot.health.bias_fitness;
+    health.buf_fitness  += slot.health.buf_fitness;
+    health.elec_colls   += slot.health.elec_colls;
+    health.instr_colls  += slot.health.instr_colls;
+    health.late_penalty += ( (course.vec_avail_times[slot.time] & MASK_TIME) >> 16).to_ulong();
+    health.room_colls   += slot.health.room_colls;
+    health.sched        += can_schedule (slot.health) ? 1 : 0;
+  };
+
+  /*! Removes the health of a scheduled course from the health of a state */
+  void sub_health (health_t &health, const course_t &course, const slot_t &slot)
+  {
+    health.avoid_colls  -= slot.health.avoid_colls;
+    health.bias_fitness -= slot.health.bias_fitness;
+    health.buf_fitness  -= slot.health.buf_fitness;
+    health.elec_colls   -= slot.health.elec_colls;
+    health.instr_colls  -= slot.health.instr_colls;
+    health.late_penalty -= ( (course.vec_avail_times[slot.time] & MASK_TIME) >> 16).to_ulong();
+    health.room_colls   -= slot.health.room_colls;
+    health.sched        -= can_schedule (slot.health) ? 1 : 0;
+  };
+
+  /*! Returns the interned room of a course given its slot */
+  int room_sym (const course_t &course, const slot_t &slot)
+  {
+    return slot.room < 0 ? course.room_sym : course.vec_prooms[slot.room].sym;
+  };
+
   /*!
     Returns the number of day collisions multiplied by the number of time
-    collisions. POPCNT may offer additional speedup?
+    collisions.  bs_t::count uses POPCNT where available.
   */
   inline int num_conflicts (const bs_t &bs)
   {
@@ -137,28 +376,238 @@ public:
 
   /*!
     Optimization routine containing the simulated annealing algorithm.  Upon
-    completion, data are saved to file and execution returns to main().
+    completion, data are saved to file and execution returns to main().  With
+    STARTS greater than 1, multistart is used instead, otherwise with REPLICAS
+    greater than 1, temper is used.
   */
   void optimize         ();
 
+  /*!
+    Anneals a single chain from TEMP_INIT until stop_run says to stop, given
+    time_limit seconds, 0 for no limit.  Stats are sent to the console every
+    POLL iterations if verbose is true.
+  */
+  void run_chain        (chain_t &chain, bool verbose, double time_limit);
+
+  /*!
+    Starts run with the time limit given in seconds, 0 for no limit.  With
+    TEMP-INIT set to AUTO the initial temperature is calibrated on chain.
+  */
+  void init_run         (run_t &run, chain_t &chain, double time_limit);
+
+  /*!
+    Returns an initial temperature at which the average uphill move from the
+    first state of chain is accepted with probability TEMP_ACCEPT, sampling
+    TEMP_SAMPLES perturbed states.  chain is left with that first state.
+  */
+  double calibrate      (chain_t &chain);
+
+  /*!
+    Returns the temperature to follow temp at iteration iter according to
+    COOLING.  accepted is the fraction of states accepted since the last call,
+    per iteration.
+  */
+  double cool           (run_t &run, int iter, double temp, double accepted);
+
+  /*!
+    Called after every iteration with the state kept so far, the number of
+    iterations done, and the temperature of the last one.  Returns true and
+    sets run.reason once the temperature falls to TEMP_MIN or a limit set in
+    sched.cfg is reached: TIME-LIMIT, MAX-ITERATIONS, STOP-SCHEDULED, or
+    STAGNATION.  A run.length that is not finite also stops the run.
+    Otherwise adapts run.length to the remaining budget.
+  */
+  bool stop_run         (run_t &run, const state_t &state, int iter, double temp);
+
+  /*!
+    Anneals STARTS independent chains, each with its own seed, on THREADS
+    threads.  The seed and fitness of every chain is sent to the console and
+    the best state is saved.  TIME-LIMIT is shared out between the chains each
+    thread runs.
+  */
+  void multistart       ();
+
+  /*!
+    Called from multistart on each thread to run chains until none are left,
+    each given time_limit seconds
+  */
+  void multistart_thread (
+    std::vector<chain_t>            &vec_chain,
+    std::atomic<int>                &next,
+    double                          time_limit);
+
+  /*!
+    Parallel tempering: REPLICAS chains are annealed on THREADS threads at a
+    geometric ladder of temperatures TEMP_LADDER apart.  Every SWAP-INTERVAL
+    iterations, neighbouring replicas exchange states.  The best state of any
+    replica is saved.
+  */
+  void temper           ();
+
+  /*!
+    Started by temper on each of its threads.  Every round it anneals every
+    step-th chain, starting with first, for one iteration per entry of
+    vec_temp, the temperatures of the coldest replica.
+  */
+  void temper_thread    (
+    std::vector<chain_t>            &vec_chain,
+    int                             first,
+    int                             step,
+    const std::vector<double>       &vec_temp,
+    rounds_t                        &rounds);
+
+  /*! Seeds a chain from m_rng and fills it with the courses to schedule */
+  void init_chain       (chain_t &chain);
+
+  /*!
+    Perturbs the state of a chain with a move drawn by pick_move and accepts or
+    rejects it at temp.  Returns true if accepted.
+  */
+  bool anneal           (chain_t &chain, double temp);
+
+  /*! Returns a move drawn with the weights of the MOVE-* options */
+  e_move pick_move      (prng_t &my_rng);
+
+  /*!
+    Returns the first of MOVE_PROBES random courses that cannot be scheduled,
+    or the last of them if all can
+  */
+  int pick_course       (const state_t &state, prng_t &my_rng);
+
+  /*!
+    Makes a MOVE_TIME, MOVE_ROOM, or MOVE_KEMPE move on the accepted state of
+    chain in place and accepts or rejects it at temp.  Returns true if
+    accepted, otherwise the state is restored.
+
+    Only the courses that share an interned course, instructor, or room with
+    a moved course are rescored, see set_slot.  Checkpoints after the first
+    moved position are marked stale and retaken by the next perturb_state.
+  */
+  bool local_move       (chain_t &chain, e_move move, double temp);
+
+  /*!
+    Gives course c of state the time and room indices given.  The health of c
+    and of the courses scheduled after it that look at its bit schedule are
+    rescored, as are the totals in state.health.  The previous slot of every
+    course changed is appended to vec_undo.  base holds the constant courses.
+  */
+  void set_slot         (
+    state_t                         &state,
+    const uidx_t                    &base,
+    int                             c,
+    int                             time,
+    int                             room,
+    std::vector<std::pair<int, slot_t> > &vec_undo);
+
+  /*!
+    Counts the collisions of course c with its slot in state against the
+    courses scheduled before it, as get_bitsched would, into slot.health
+  */
+  void score_slot       (const state_t &state, const uidx_t &base, int c, slot_t &slot);
+
+  /*!
+    Returns base ORed with the bit schedules of the courses in vec_member
+    other than c scheduled before position pos
+  */
+  bs_t prefix_bs        (
+    const state_t                   &state,
+    const std::vector<int>          &vec_member,
+    const bs_t                      &base,
+    int                             c,
+    int                             pos);
+
+  /*!
+    Fills vec_kempe with course c, then the courses it conflicts with in the
+    time of a conflicting course, and so on, each with the index of the time
+    it moves to.  Returns false if there is no such chain, one of its courses
+    cannot take the other time, or it is longer than KEMPE_MAX.
+  */
+  bool kempe_chain      (
+    const state_t                   &state,
+    int                             c,
+    prng_t                          &my_rng,
+    std::vector<std::pair<int, int> > &vec_kempe);
+
+  /*!
+    Appends the courses that can collide with course c to vec_nbr: its hard
+    neighbours in m_graph and those sharing its room.  Courses may be appended
+    more than once.
+  */
+  void get_neighbours   (const state_t &state, int c, std::vector<int> &vec_nbr);
+
+  /*! Moves course c from one room list of state to another, -1 for none */
+  void move_room        (state_t &state, int c, int from, int to);
+
+  /*!
+    Fills vec_crs with copies of the courses in state in the order they were
+    scheduled, with the bit schedule, room, and health of their slots
+  */
+  void get_courses      (const state_t &state, std::vector<course_t> &vec_crs);
+
   /*! Sends stats to console: iteration, fitness, temperature, etc. */
   void display_stats    (const state_t &state, int iter);
 
+  /*! Sends the number of states each move proposed and had accepted to console */
+  void display_moves    (const std::vector<chain_t> &vec_chain);
+
+  /*! Sends the size, degrees, and clique estimates of m_graph to console */
+  void display_graph    ();
+
+  /*!
+    Restores what read_csv parsed and m_graph from FILE_SNAPSHOT.  Returns false
+    with the reason if there is no snapshot, or it was written by another
+    version, from other CSVs or options, or fails its checksum.
+  */
+  bool load_snapshot    (std::string &reason);
+
+  /*!
+    Writes what read_csv parsed and m_graph to FILE_SNAPSHOT.  Returns false if
+    it could not be written.
+  */
+  bool save_snapshot    ();
+
   /*!
     Called from optimize to output data to files, that is, html tables and
-    scheduled.csv and failed.csv.
+    scheduled.csv and failed.csv, in OUTPUT-DIR.  Existing files are
+    overwritten, kept, or the user asked, as OVERWRITE is YES, NO, or ASK.
   */
   void save_scheds      (state_t &state);
 
-  /*! Called from save_scheds to output schedules to HTML files using tables */
-  void write_html       (std::ofstream &file, std::map<std::string, Week> &mapstr_cal);
+  /*!
+    Called from save_scheds once the files in vec_file are committed to write
+    FILE_MANIFEST: when and how well the schedules were made, and the size and
+    hash of each file.  Returns false if it could not be written.
+  */
+  bool write_manifest (
+    const state_t                   &state,
+    outfile_t                       *vec_file[],
+    const std::string               *vec_name[],
+    int                             files);
 
-  /*! Returns run time */
-  int duration          ();
+  /*!
+    Called from save_scheds to output schedules to HTML files using tables,
+    rendered on up to threads threads
+  */
+  void write_html (
+    outfile_t                       &file,
+    const Calendar                  &cal,
+    const std::vector<course_t>     &vec_crs,
+    int                             threads);
+
+  /*! Called from write_html to append the tables of members [first, last) to str */
+  void render_html (
+    std::string                                         &str,
+    const Calendar                                      &cal,
+    const std::vector<course_t>                         &vec_crs,
+    std::map<std::string, size_t>::const_iterator       first,
+    std::map<std::string, size_t>::const_iterator       last) const;
+
+  /*! Returns run time in seconds */
+  double duration       ();
 
 private:
   /*! Used for referencing html_header.txt */
-  std::ifstream header_file;
+  mapfile_t header_file;
 
   /*! Holds data read in from html_header.txt */
   std::vector<std::string> m_vec_header;
@@ -167,24 +616,78 @@ private:
   prng_t m_rng;
 
   /*! Used to track optimization run time */
-  time_t m_end_time;
+  sched_clock_t::time_point m_end_time;
 
   /*! Used to track optimization run time */
-  time_t m_start_time;
+  sched_clock_t::time_point m_start_time;
 
   /*! Used to track the best fit schedule */
   int m_best_fitness;
+
+  /*! Set by save_scheds once the schedules are written */
+  bool m_saved;
+
+  /*! Courses to be scheduled, indexed by state_t::vec_order */
+  std::vector<course_t> m_vec_crs;
+
+  /*! BUFFER, INCREMENTAL, POLL, and REDUCTION options */
+  int m_room_buf;
+  bool m_incremental;
+  int m_poll;
+  double m_reduction;
+
+  /*! COOLING and TEMP-INIT options, m_temp_init is 0 for AUTO */
+  e_cooling m_cooling;
+  double m_temp_init;
+
+  /*! Stopping criteria: TIME-LIMIT, MAX-ITERATIONS, STAGNATION, STOP-SCHEDULED */
+  double m_time_limit;
+  int m_max_iters;
+  int m_stagnation;
+  bool m_stop_sched;
+
+  /*! MOVE-* options and their sum */
+  double m_move_weight[MOVES];
+  double m_move_total;
+
+  /*!
+    Conflict graph of m_vec_crs.  Local moves rescore the neighbours of the
+    courses they move.
+  */
+  graph_t m_graph;
+
+  /*!
+    Courses indexed by interned course and interned instructor, used by local
+    moves to OR the bit schedules scheduled before a course
+  */
+  std::vector<std::vector<int> > m_crs_by_name;
+  std::vector<std::vector<int> > m_crs_by_instr;
+
+  /*!
+    Universal indices holding only the constant courses, which are scheduled
+    the same in every state.  Built once the problem is loaded, every state is
+    scheduled on top of a copy.
+  */
+  uidx_t m_const_uidx;
 };
 
 namespace
 {
 /*!
   Annealing parameters are sensitive to the schedule fitness and must be
-  modified accordingly
+  modified accordingly.  TEMP_INIT is used if TEMP-INIT is AUTO but no uphill
+  move was sampled.
 */
 const double TEMP_INIT  = 1.0e+1;
 const double TEMP_MIN   = 1.0e-5;
 
+/*! Used by calibrate: initial acceptance probability of an average uphill move */
+const double TEMP_ACCEPT  = 0.8;
+const int    TEMP_SAMPLES = 100;
+
+/*! Ratio between the temperatures of neighbouring replicas in temper */
+const double TEMP_LADDER = 2.0;
+
 /*!
   Coefficients used in get_bitched for ordering candidate schedules for
   classes.
@@ -193,6 +696,16 @@ const double CMUL_AVOID =  5.062;
 const double CMUL_ELEC  =  1.000;
 const double CMUL_INSTR = 18.148;
 const double CMUL_ROOM  = 18.604;
+
+/*! Added for blocked times, more than any number of collisions can cost */
+const double CMUL_VOID  = 1.0e+12;
+
+/*! Fewest groups, instructors, or rooms rendered by each thread of write_html */
+const int HTML_CHUNK = 64;
+
+/*! Courses probed by pick_course, and the longest chain a Kempe move swaps */
+const int MOVE_PROBES = 8;
+const int KEMPE_MAX   = 16;
 }
 
 #endif // !defined(SCHEDULE_HPP)
@@ -0,0 +1,191 @@
+/*
+ *    SACS, a Simulated Annealing Class Scheduler
+ *    Copyright (C) 2011-2012  Martin Wyngaarden
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cassert>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SCORE_X86
+#include <immintrin.h>
+#endif
+
+#include "score.hpp"
+#include "utility.hpp"
+
+using namespace std;
+
+
+score_fn_t add_conflicts = add_conflicts_scalar;
+
+/*! Same as Schedule::num_conflicts */
+static inline int conflicts (const bs_t &bs)
+{
+  return (bs & MASK_DAY).count() * (bs & MASK_TIME).count();
+}
+
+void add_conflicts_scalar (
+  const bs_t        *cand,
+  int               n,
+  const bs_t        *idx,
+  const int         *sym,
+  int               m,
+  int               *colls)
+{
+  for (int i = 0; i < n; i++)
+    for (int j = 0; j < m; j++)
+      colls[i] += conflicts (idx[sym[j]] & cand[i]);
+}
+
+#if defined(SCORE_X86)
+
+/*!
+  Day bits are all in the top byte of a bit schedule and time bits in the bytes
+  below it, so the day count is the top byte of the per-byte counts and the time
+  count is the sum of the rest.
+*/
+__attribute__ ( (target ("avx2") ) )
+void add_conflicts_avx2 (
+  const bs_t        *cand,
+  int               n,
+  const bs_t        *idx,
+  const int         *sym,
+  int               m,
+  int               *colls)
+{
+  const __m256i mask   = _mm256_set1_epi64x ( (MASK_DAY | MASK_TIME).to_ullong() );
+  const __m256i nibble = _mm256_set1_epi8 (0x0f);
+  const __m256i lookup = _mm256_setr_epi8 (
+    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i zero   = _mm256_setzero_si256();
+
+  int i;
+  alignas (32) uint64_t sum[4];
+
+  for (i = 0; i + 4 <= n; i += 4)
+  {
+    __m256i c   = _mm256_and_si256 (_mm256_loadu_si256 (reinterpret_cast<const __m256i *> (cand + i) ), mask);
+    __m256i acc = zero;
+
+    for (int j = 0; j < m; j++)
+    {
+      __m256i x     = _mm256_and_si256 (_mm256_set1_epi64x (idx[sym[j]].to_ullong() ), c);
+      __m256i bytes = _mm256_add_epi8 (
+                        _mm256_shuffle_epi8 (lookup, _mm256_and_si256 (x, nibble) ),
+                        _mm256_shuffle_epi8 (lookup, _mm256_and_si256 (_mm256_srli_epi16 (x, 4), nibble) ) );
+      __m256i days  = _mm256_srli_epi64 (bytes, 56);
+      __m256i times = _mm256_sub_epi64 (_mm256_sad_epu8 (bytes, zero), days);
+      acc = _mm256_add_epi64 (acc, _mm256_mul_epu32 (days, times) );
+    }
+
+    _mm256_store_si256 (reinterpret_cast<__m256i *> (sum), acc);
+
+    for (int k = 0; k < 4; k++)
+      colls[i + k] += static_cast<int> (sum[k]);
+  }
+
+  add_conflicts_scalar (cand + i, n - i, idx, sym, m, colls + i);
+}
+
+__attribute__ ( (target ("avx512f,avx512vpopcntdq") ) )
+void add_conflicts_avx512 (
+  const bs_t        *cand,
+  int               n,
+  const bs_t        *idx,
+  const int         *sym,
+  int               m,
+  int               *colls)
+{
+  const __m512i day  = _mm512_set1_epi64 (MASK_DAY.to_ullong() );
+  const __m512i time = _mm512_set1_epi64 (MASK_TIME.to_ullong() );
+
+  alignas (64) uint64_t sum[8];
+
+  for (int i = 0; i < n; i += 8)
+  {
+    __mmask8 lanes = n - i >= 8 ? 0xff : static_cast<__mmask8> ( (1 << (n - i) ) - 1);
+    __m512i c   = _mm512_maskz_loadu_epi64 (lanes, cand + i);
+    __m512i acc = _mm512_setzero_si512();
+
+    for (int j = 0; j < m; j++)
+    {
+      __m512i x = _mm512_and_si512 (_mm512_set1_epi64 (idx[sym[j]].to_ullong() ), c);
+      // Counts fit in the low half of each lane, so a 32-bit multiply will do
+      acc = _mm512_add_epi64 (acc, _mm512_mullo_epi32 (
+                                _mm512_popcnt_epi64 (_mm512_and_si512 (x, day) ),
+                                _mm512_popcnt_epi64 (_mm512_and_si512 (x, time) ) ) );
+    }
+
+    _mm512_store_si512 (sum, acc);
+
+    for (int k = 0; k < 8 && i + k < n; k++)
+      colls[i + k] += static_cast<int> (sum[k]);
+  }
+}
+
+bool score_supported (const string &isa)
+{
+  __builtin_cpu_init();
+
+  if (isa == "AVX512")
+    return __builtin_cpu_supports ("avx512f") && __builtin_cpu_supports ("avx512vpopcntdq");
+
+  if (isa == "AVX2")
+    return __builtin_cpu_supports ("avx2");
+
+  return isa == "SCALAR";
+}
+
+#else
+
+void add_conflicts_avx2 (const bs_t *cand, int n, const bs_t *idx, const int *sym, int m, int *colls)
+{
+  add_conflicts_scalar (cand, n, idx, sym, m, colls);
+}
+
+void add_conflicts_avx512 (const bs_t *cand, int n, const bs_t *idx, const int *sym, int m, int *colls)
+{
+  add_conflicts_scalar (cand, n, idx, sym, m, colls);
+}
+
+bool score_supported (const string &isa)
+{
+  return isa == "SCALAR";
+}
+
+#endif // defined(SCORE_X86)
+
+string score_init (const string &isa)
+{
+  if (isa != "AUTO" && isa != "AVX512" && isa != "AVX2" && isa != "SCALAR")
+    return "";
+
+  if ( (isa == "AVX512" || isa == "AUTO") && score_supported ("AVX512") )
+  {
+    add_conflicts = add_conflicts_avx512;
+    return "AVX512";
+  }
+
+  if ( (isa == "AVX512" || isa == "AVX2" || isa == "AUTO") && score_supported ("AVX2") )
+  {
+    add_conflicts = add_conflicts_avx2;
+    return "AVX2";
+  }
+
+  add_conflicts = add_conflicts_scalar;
+  return "SCALAR";
+}
@@ -0,0 +1,64 @@
+/*
+ *    SACS, a Simulated Annealing Class Scheduler
+ *    Copyright (C) 2011-2012  Martin Wyngaarden
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#if !defined(SCORE_HPP)
+#define SCORE_HPP
+
+#include <string>
+
+#include "utility.hpp"
+
+/*!
+  Candidate scorers used by Schedule::get_bitsched.  Each one scores a batch of
+  candidate bit schedules against a list of universal index entries:
+
+    for each candidate i in cand[0, n)
+      for each symbol in sym[0, m)
+        colls[i] += num_conflicts (idx[symbol] & cand[i])
+
+  The vector scorers broadcast one index entry against 4 (AVX2) or 8 (AVX-512)
+  candidates at a time and give exactly the same counts as the scalar scorer.
+*/
+typedef void (*score_fn_t) (
+  const bs_t        *cand,
+  int               n,
+  const bs_t        *idx,
+  const int         *sym,
+  int               m,
+  int               *colls);
+
+/*! The scorer selected by score_init */
+extern score_fn_t add_conflicts;
+
+/*!
+  Selects the scorer by name: AVX512, AVX2, or SCALAR.  AUTO, or a scorer the
+  CPU does not support, picks the best one available.  Returns the name of the
+  scorer selected, or an empty string for an unknown name, which selects none.
+*/
+std::string score_init (const std::string &isa);
+
+/*! The individual scorers, only call those the CPU supports */
+void add_conflicts_scalar (const bs_t *cand, int n, const bs_t *idx, const int *sym, int m, int *colls);
+void add_conflicts_avx2   (const bs_t *cand, int n, const bs_t *idx, const int *sym, int m, int *colls);
+void add_conflicts_avx512 (const bs_t *cand, int n, const bs_t *idx, const int *sym, int m, int *colls);
+
+/*! Returns true if the CPU supports the named scorer */
+bool score_supported (const std::string &isa);
+
+#endif // !defined(SCORE_HPP)
@@ -0,0 +1,536 @@
+/*
+ *    SACS, a Simulated Annealing Class Scheduler
+ *    Copyright (C) 2011-2012  Martin Wyngaarden
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+  Snapshots of the parsed problem.  A snapshot is a header followed by a
+  payload in native byte order:
+
+    stamp:    the options push_course reads, and the size and modification
+              time of each CSV
+    Room:     interned rooms, lab rooms, standard rooms, warnings of rooms.csv
+    Bias:     interned instructors and the compiled bias tables
+    Course:   groups, interned courses, constant courses, courses
+    Schedule: the conflict graph
+
+  Strings and containers are written as a 64-bit count followed by their
+  elements.  The payload checksum is only computed once the stamp matches, so
+  an out of date snapshot is rejected without reading the rest of it.
+*/
+
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "mapfile.hpp"
+#include "outfile.hpp"
+#include "schedule.hpp"
+#include "utility.hpp"
+
+using namespace std;
+
+
+namespace
+{
+/*! Bumped whenever what is written, or a type written whole, changes */
+const uint32_t SNAP_VERSION = 2;
+
+/*! Reads back differently if the snapshot was written in another byte order */
+const uint32_t SNAP_ORDER   = 0x01020304;
+
+const char SNAP_MAGIC[8] = { 'S', 'A', 'C', 'S', 'S', 'N', 'A', 'P' };
+
+struct snap_header_t
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t order;
+  uint64_t size;
+  uint64_t checksum;
+};
+
+/*! FNV-1a over 64-bit words, then the remaining bytes */
+uint64_t snap_checksum (const char *data, size_t size)
+{
+  const uint64_t prime = 0x100000001b3ULL;
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  uint64_t word;
+  size_t i;
+
+  for (i = 0; i + 8 <= size; i += 8)
+  {
+    memcpy (&word, data + i, 8);
+    hash = (hash ^ word) * prime;
+  }
+
+  for ( ; i < size; i++)
+    hash = (hash ^ static_cast<uint8_t> (data[i]) ) * prime;
+
+  return hash;
+}
+
+/*! Appends values to a payload */
+class snap_writer_t
+{
+public:
+  template <class T>
+  void operator() (const T &value)
+  {
+    static_assert (is_trivially_copyable<T>::value, "write the members instead");
+    m_buf.append (reinterpret_cast<const char *> (&value), sizeof (T) );
+  };
+
+  void operator() (const string &str)
+  {
+    (*this) (static_cast<uint64_t> (str.size() ) );
+    m_buf.append (str);
+  };
+
+  template <class T>
+  void operator() (const vector<T> &vec)
+  {
+    (*this) (static_cast<uint64_t> (vec.size() ) );
+
+    if constexpr (is_trivially_copyable<T>::value)
+      m_buf.append (reinterpret_cast<const char *> (vec.data() ), vec.size() * sizeof (T) );
+
+    else
+      for (auto it = vec.begin(); it != vec.end(); it++)
+        (*this) (*it);
+  };
+
+  template <class T, class C>
+  void operator() (const map<string, T, C> &mapstr)
+  {
+    (*this) (static_cast<uint64_t> (mapstr.size() ) );
+
+    for (auto it = mapstr.begin(); it != mapstr.end(); it++)
+    {
+      (*this) (it->first);
+      (*this) (it->second);
+    }
+  };
+
+  void operator() (const symtab_t &sym)
+  {
+    (*this) (static_cast<uint64_t> (sym.size() ) );
+
+    for (int i = 0; i < sym.size(); i++)
+      (*this) (sym.name (i) );
+  };
+
+  void operator() (const room_t &room);
+  void operator() (const course_t &course);
+  void operator() (const graph_t &graph);
+
+  string m_buf;
+};
+
+/*!
+  Reads values back from a payload.  Reading past the end or an impossible
+  count sets m_fail and leaves the value empty.
+*/
+class snap_reader_t
+{
+public:
+  snap_reader_t (const char *data, size_t size) :
+    m_pos (data), m_end (data + size), m_fail (false) {};
+
+  template <class T>
+  void operator() (T &value)
+  {
+    static_assert (is_trivially_copyable<T>::value, "read the members instead");
+
+    if (!take (sizeof (T) ) )
+    {
+      value = T();
+      return;
+    }
+
+    memcpy (&value, m_pos - sizeof (T), sizeof (T) );
+  };
+
+  void operator() (string &str)
+  {
+    uint64_t n = count (1);
+
+    if (take (n) )
+      str.assign (m_pos - n, n);
+
+    else
+      str.clear();
+  };
+
+  template <class T>
+  void operator() (vector<T> &vec)
+  {
+    if constexpr (is_trivially_copyable<T>::value)
+    {
+      uint64_t n = count (sizeof (T) );
+      vec.resize (n);
+
+      // An empty vector may have no data() to copy to
+      if (take (n * sizeof (T) ) && n)
+        memcpy (vec.data(), m_pos - n * sizeof (T), n * sizeof (T) );
+    }
+    else
+    {
+      uint64_t n = count (1);
+      vec.resize (n);
+
+      for (auto it = vec.begin(); it != vec.end() && !m_fail; it++)
+        (*this) (*it);
+    }
+  };
+
+  template <class T, class C>
+  void operator() (map<string, T, C> &mapstr)
+  {
+    string key;
+    T value;
+
+    mapstr.clear();
+
+    for (uint64_t n = count (1); n > 0 && !m_fail; n--)
+    {
+      (*this) (key);
+      (*this) (value);
+      mapstr.emplace_hint (mapstr.end(), move (key), move (value) );
+    }
+  };
+
+  void operator() (symtab_t &sym)
+  {
+    string name;
+
+    for (uint64_t n = count (1), i = 0; i < n && !m_fail; i++)
+    {
+      (*this) (name);
+
+      // Names are unique, so interning them in order gives the same symbols
+      if (!m_fail && sym.intern (name) != static_cast<int> (i) )
+        m_fail = true;
+    }
+  };
+
+  void operator() (room_t &room);
+  void operator() (course_t &course);
+  void operator() (graph_t &graph);
+
+  /*! Returns true if every value was read and nothing is left over */
+  bool done() const
+  {
+    return !m_fail && m_pos == m_end;
+  };
+
+  bool fail() const
+  {
+    return m_fail;
+  };
+
+private:
+  /*! Steps over n bytes, returns false if there are not that many left */
+  bool take (uint64_t n)
+  {
+    if (m_fail || n > static_cast<uint64_t> (m_end - m_pos) )
+    {
+      m_fail = true;
+      return false;
+    }
+
+    m_pos += n;
+    return true;
+  };
+
+  /*! Reads the count of a container whose elements take at least size bytes */
+  uint64_t count (uint64_t size)
+  {
+    uint64_t n;
+    (*this) (n);
+
+    if (n > static_cast<uint64_t> (m_end - m_pos) / size)
+    {
+      m_fail = true;
+      return 0;
+    }
+
+    return n;
+  };
+
+  const char *m_pos;
+  const char *m_end;
+  bool m_fail;
+};
+
+/*!
+  The members written for each type, in order.  Shared by the writer and the
+  reader, so that the two cannot disagree.
+*/
+template <class io_t, class room_ref_t>
+void snap_room (io_t &io, room_ref_t &room)
+{
+  io (room.id);
+  io (room.size);
+  io (room.sym);
+}
+
+template <class io_t, class crs_ref_t>
+void snap_course (io_t &io, crs_ref_t &course)
+{
+  io (course.const_days);
+  io (course.const_room);
+  io (course.const_time);
+  io (course.is_lab);
+  io (course.multi_days);
+  io (course.end_time);
+  io (course.start_time);
+  io (course.hours);
+  io (course.lectures);
+  io (course.name_sym);
+  io (course.room_sym);
+  io (course.size);
+  io (course.bs_sched);
+  io (course.group);
+  io (course.id);
+  io (course.name);
+  io (course.room_id);
+  io (course.vec_avail_times);
+  io (course.vec_avoid);
+  io (course.vec_elec);
+  io (course.vec_instr);
+  io (course.vec_avoid_sym);
+  io (course.vec_bias);
+  io (course.vec_elec_sym);
+  io (course.vec_instr_sym);
+  io (course.vec_prooms);
+  io (course.vec_days);
+  io (course.days);
+}
+
+template <class io_t, class graph_ref_t>
+void snap_graph (io_t &io, graph_ref_t &graph)
+{
+  io (graph.vec_start);
+  io (graph.vec_adj);
+  io (graph.vec_kind);
+  io (graph.vec_weight);
+}
+
+void snap_writer_t::operator() (const room_t &room)
+{
+  snap_room (*this, room);
+}
+
+void snap_writer_t::operator() (const course_t &course)
+{
+  snap_course (*this, course);
+}
+
+void snap_writer_t::operator() (const graph_t &graph)
+{
+  snap_graph (*this, graph);
+}
+
+void snap_reader_t::operator() (room_t &room)
+{
+  snap_room (*this, room);
+}
+
+void snap_reader_t::operator() (course_t &course)
+{
+  course.reset();
+  snap_course (*this, course);
+}
+
+void snap_reader_t::operator() (graph_t &graph)
+{
+  snap_graph (*this, graph);
+}
+
+/*!
+  What a snapshot was compiled from.  A snapshot is only loaded if its stamp
+  is the same as the stamp of the CSVs and options now.
+*/
+string snap_stamp()
+{
+  const string *vec_file[] = { &FILE_BIAS, &FILE_ROOM, &FILE_GROUP, &FILE_COURSE };
+  const char *vec_opt[] = { "CONTIGUOUS-LABS", "LAB-START-TIME", "LAB-END-TIME" };
+
+  snap_writer_t out;
+  error_code ec;
+
+  for (auto it = begin (vec_opt); it != end (vec_opt); it++)
+    out (prog_opts[*it]);
+
+  for (auto it = begin (vec_file); it != end (vec_file); it++)
+  {
+    string path = input_path (**it);
+
+    uintmax_t size = filesystem::file_size (path, ec);
+    out (static_cast<uint64_t> (ec ? 0 : size) );
+
+    auto mtime = filesystem::last_write_time (path, ec);
+    out (static_cast<int64_t> (ec ? 0 : mtime.time_since_epoch().count() ) );
+  }
+
+  return out.m_buf;
+}
+}
+
+bool Schedule::load_snapshot (string &reason)
+{
+  mapfile_t file;
+  snap_header_t header;
+
+  if (!file.open (input_path (FILE_SNAPSHOT) ) )
+  {
+    reason = "not found";
+    return false;
+  }
+
+  if (file.size() < sizeof (header) )
+  {
+    reason = "invalid format";
+    return false;
+  }
+
+  memcpy (&header, file.data(), sizeof (header) );
+
+  if (memcmp (header.magic, SNAP_MAGIC, sizeof (SNAP_MAGIC) ) || header.order != SNAP_ORDER)
+  {
+    reason = "invalid format";
+    return false;
+  }
+
+  if (header.version != SNAP_VERSION)
+  {
+    reason = "written by another version";
+    return false;
+  }
+
+  if (header.size != file.size() - sizeof (header) )
+  {
+    reason = "truncated";
+    return false;
+  }
+
+  const char *payload = file.data() + sizeof (header);
+  snap_reader_t in (payload, header.size);
+  string stamp;
+  in (stamp);
+
+  if (in.fail() || stamp != snap_stamp() )
+  {
+    reason = "out of date";
+    return false;
+  }
+
+  if (snap_checksum (payload, header.size) != header.checksum)
+  {
+    reason = "checksum mismatch";
+    return false;
+  }
+
+  in (m_sym_room);
+  in (m_mapstr_labrooms);
+  in (m_mapstr_stdrooms);
+  in (m_vec_room_warning);
+
+  in (m_sym_instr);
+  in (m_bias_all);
+  in (m_bias_rows);
+  in (m_vec_bias);
+  in (m_vec_bias_sum);
+  in (m_vec_void);
+
+  in (m_mapstr_core);
+  in (m_mapstr_elec);
+  in (m_sym_crs);
+  in (m_mapstr_const_course);
+  in (m_mapstr_course);
+
+  in (m_graph);
+
+  Debug debug;
+
+  // The checksum matched, so only a bug in the writer gets here
+  if (!in.done() )
+    debug.push_error ("Invalid snapshot, delete " + input_path (FILE_SNAPSHOT) + " and run again");
+
+  // read_rooms is not run, so its warnings are given from the snapshot
+  for (auto it = m_vec_room_warning.begin(); it != m_vec_room_warning.end(); it++)
+    debug.push_warning (*it);
+
+  debug.live_or_die();
+
+  reason = "";
+  return true;
+}
+
+bool Schedule::save_snapshot()
+{
+  snap_writer_t out;
+  snap_header_t header;
+
+  out (snap_stamp() );
+
+  out (m_sym_room);
+  out (m_mapstr_labrooms);
+  out (m_mapstr_stdrooms);
+  out (m_vec_room_warning);
+
+  out (m_sym_instr);
+  out (m_bias_all);
+  out (m_bias_rows);
+  out (m_vec_bias);
+  out (m_vec_bias_sum);
+  out (m_vec_void);
+
+  out (m_mapstr_core);
+  out (m_mapstr_elec);
+  out (m_sym_crs);
+  out (m_mapstr_const_course);
+  out (m_mapstr_course);
+
+  out (m_graph);
+
+  memset (&header, 0, sizeof (header) );
+  memcpy (header.magic, SNAP_MAGIC, sizeof (SNAP_MAGIC) );
+  header.version  = SNAP_VERSION;
+  header.order    = SNAP_ORDER;
+  header.size     = out.m_buf.size();
+  header.checksum = snap_checksum (out.m_buf.data(), out.m_buf.size() );
+
+  /*
+    Written to a temporary file and renamed over the old snapshot, so a run
+    that has the old one mapped keeps reading it whole, and a run that stops
+    while writing leaves no half written snapshot behind.
+  */
+  outfile_t file;
+
+  if (!file.open (input_path (FILE_SNAPSHOT), true) )
+    return false;
+
+  file << string_view (reinterpret_cast<const char *> (&header), sizeof (header) );
+  file << string_view (out.m_buf);
+
+  return file.close() && file.commit();
+}
@@ -18,6 +18,7 @@
 
 #include <algorithm>
 #include <cctype>
+#include <cstdlib>
 #include <fstream>
 
 #include "utility.hpp"
@@ -25,27 +26,24 @@
 using namespace std;
 
 
+#if defined(__GNUC__) && defined(__x86_64__)
+const bool cpu_popcnt = __builtin_cpu_supports ("popcnt");
+#else
+const bool cpu_popcnt = false;
+#endif
+
 map<string, string> prog_opts;
 vector<vector<int> > vec_bitpos_idx;
 vector<vector<bs_t> > sched_bs_idx;
 
 void util_init()
 {
-  int i, j, k;
-  string str;
+  int i, j;
   sched_bs_idx.resize (6);
 
   for (i = 0; i < 6; i++)
-  {
     for (j = 0; j < sched_count_idx[i]; j++)
-    {
-      for (k = 0, str = ""; k < 16; k++)
-        str += hex_to_bin (sched_hex_idx[i][j][k]);
-
-      bs_t bs (str);
-      sched_bs_idx[i].push_back (bs);
-    }
-  }
+      sched_bs_idx[i].push_back (bs_t (strtoull (sched_hex_idx[i][j].c_str(), NULL, 16) ) );
 
   vec_bitpos_idx.resize (128);
 
@@ -55,6 +53,39 @@ void util_init()
         vec_bitpos_idx[i].push_back (48 * j);
 }
 
+void opts_init()
+{
+  prog_opts["BUFFER"]          = "4";
+  prog_opts["CONTIGUOUS-LABS"] = "TRUE";
+  prog_opts["COOLING"]         = "GEOMETRIC";
+  prog_opts["GRAPH-STATS"]     = "FALSE";
+  prog_opts["INCREMENTAL"]     = "TRUE";
+  prog_opts["INPUT-DIR"]       = "";
+  prog_opts["LAB-START-TIME"]  = "8";
+  prog_opts["LAB-END-TIME"]    = "21";
+  prog_opts["MAX-ITERATIONS"]  = "0";
+  prog_opts["MOVE-FRONT"]      = "0";
+  prog_opts["MOVE-KEMPE"]      = "0";
+  prog_opts["MOVE-ROOM"]       = "0";
+  prog_opts["MOVE-SWAP"]       = "1";
+  prog_opts["MOVE-TIME"]       = "0";
+  prog_opts["OUTPUT-DIR"]      = "";
+  prog_opts["OVERWRITE"]       = "ASK";
+  prog_opts["POLL"]            = "10";
+  prog_opts["REDUCTION"]       = "0.99";
+  prog_opts["REPLICAS"]        = "1";
+  prog_opts["SIMD"]            = "AUTO";
+  prog_opts["SNAPSHOT"]        = "FALSE";
+  prog_opts["STAGNATION"]      = "0";
+  prog_opts["STARTS"]          = "1";
+  prog_opts["STOP-SCHEDULED"]  = "FALSE";
+  prog_opts["SWAP-INTERVAL"]   = "10";
+  prog_opts["TEMP-INIT"]       = "10";
+  prog_opts["THREADS"]         = "0";
+  prog_opts["TIME-LIMIT"]      = "0";
+  prog_opts["VERBOSE"]         = "TRUE";
+}
+
 string make_upper (const string &str)
 {
   string ret_str = str;
@@ -62,6 +93,21 @@ string make_upper (const string &str)
   return ret_str;
 }
 
+string_view make_upper (string_view str, string &buf)
+{
+  auto lower = [] (char c)
+  {
+    return islower (static_cast<unsigned char> (c) ) != 0;
+  };
+
+  if (none_of (str.begin(), str.end(), lower) )
+    return str;
+
+  buf.assign (str.data(), str.size() );
+  transform (buf.begin(), buf.end(), buf.begin(), ::toupper);
+  return buf;
+}
+
 int token_count (const string &str, string tok)
 {
   if (str == "")
@@ -92,6 +138,35 @@ string get_token (const string &str, int n, string delim)
   return ret_str;
 }
 
+void split (string_view str, char delim, vector<string_view> &vec_tok)
+{
+  size_t first = 0;
+  size_t last;
+
+  vec_tok.clear();
+
+  if (str.empty() )
+    return;
+
+  while ( (last = str.find (delim, first) ) != string_view::npos)
+  {
+    vec_tok.push_back (str.substr (first, last - first) );
+    first = last + 1;
+  }
+
+  vec_tok.push_back (str.substr (first) );
+}
+
+int field_to_int (string_view field)
+{
+  return atoi (string (field).c_str() );
+}
+
+double field_to_double (string_view field)
+{
+  return atof (string (field).c_str() );
+}
+
 string break_instr (const vector<string> &vec_instr)
 {
   assert (vec_instr.size() );
@@ -121,6 +196,30 @@ bool file_exists (const char *file)
   return !myfile.fail();
 }
 
+namespace
+{
+string dir_path (const string &dir, const string &file)
+{
+  if (dir.empty() )
+    return file;
+
+  if (dir.back() == '/' || dir.back() == '\\')
+    return dir + file;
+
+  return dir + "/" + file;
+}
+}
+
+string input_path (const string &file)
+{
+  return dir_path (prog_opts["INPUT-DIR"], file);
+}
+
+string output_path (const string &file)
+{
+  return dir_path (prog_opts["OUTPUT-DIR"], file);
+}
+
 uint8_t day_to_flag (const std::string &day)
 {
   assert (day != "");
@@ -156,56 +255,3 @@ string vec_to_str (const vector<string> &vec_str)
   ret_str.erase (0, 1);
   return ret_str;
 }
-
-string hex_to_bin (char hex)
-{
-  assert ( (hex >= '0' && hex <= '9') || (hex >= 'a' && hex <= 'f') );
-
-  if (hex == '0')
-    return "0000";
-
-  else if (hex == '1')
-    return "0001";
-
-  else if (hex == '2')
-    return "0010";
-
-  else if (hex == '3')
-    return "0011";
-
-  else if (hex == '4')
-    return "0100";
-
-  else if (hex == '5')
-    return "0101";
-
-  else if (hex == '6')
-    return "0110";
-
-  else if (hex == '7')
-    return "0111";
-
-  else if (hex == '8')
-    return "1000";
-
-  else if (hex == '9')
-    return "1001";
-
-  else if (hex == 'a')
-    return "1010";
-
-  else if (hex == 'b')
-    return "1011";
-
-  else if (hex == 'c')
-    return "1100";
-
-  else if (hex == 'd')
-    return "1101";
-
-  else if (hex == 'e')
-    return "1110";
-
-  else
-    return "1111";
-}
@@ -20,14 +20,67 @@
 #if !defined(UTILITY_HPP)
 #define UTILITY_HPP
 
-#include <bitset>
+#include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <functional>
 #include <map>
 #include <stdint.h>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+/*! True if the CPU has a POPCNT instruction, see popcount */
+extern const bool cpu_popcnt;
+
+/*!
+  Returns the number of set bits.  POPCNT is used if the compiler targets it or,
+  on x86-64, if cpu_popcnt is true, otherwise bits are counted in parallel.
+*/
+inline int popcount (uint64_t n)
+{
+#if defined(__POPCNT__)
+  return __builtin_popcountll (n);
+#else
+#if defined(__GNUC__) && defined(__x86_64__)
+  if (cpu_popcnt)
+  {
+    uint64_t count;
+    __asm__ ("popcnt %1, %0" : "=r" (count) : "r" (n) );
+    return static_cast<int> (count);
+  }
+#endif
+  n = n - ( (n >> 1) & 0x5555555555555555ULL);
+  n = (n & 0x3333333333333333ULL) + ( (n >> 2) & 0x3333333333333333ULL);
+  n = (n + (n >> 4) ) & 0x0f0f0f0f0f0f0f0fULL;
+  return static_cast<int> ( (n * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/*! Returns the number of zero bits below the lowest set bit, n must not be 0 */
+inline int trailing_zeros (uint64_t n)
+{
+  assert (n);
+#if defined(__GNUC__)
+  return __builtin_ctzll (n);
+#elif defined(_MSC_VER) && defined(_WIN64)
+  unsigned long index;
+  _BitScanForward64 (&index, n);
+  return static_cast<int> (index);
+#else
+  int count = 0;
+
+  for ( ; ! (n & 1); n >>= 1)
+    count++;
+
+  return count;
+#endif
+}
 
 /*!
   The zeroth bit of a bitset represents 00:00 hours, the first, 00:30, and the
@@ -36,17 +89,86 @@
 
   MASKS are used when DEBUG is defined to check for improperly constructed bit
   schedules.
+
+  bs_t wraps a 64-bit word with the parts of the std::bitset<64> interface
+  used by the program.
 */
-typedef std::bitset<64> bs_t;
+class bs_t
+{
+public:
+  constexpr bs_t() : m_bits (0) {};
+
+  constexpr bs_t (uint64_t bits) : m_bits (bits) {};
+
+  int count() const
+  {
+    return popcount (m_bits);
+  };
+
+  constexpr bool any() const
+  {
+    return m_bits != 0;
+  };
+
+  constexpr bool none() const
+  {
+    return m_bits == 0;
+  };
+
+  constexpr bool operator[] (int pos) const
+  {
+    return (m_bits >> pos) & 1;
+  };
+
+  bs_t &set (int pos, bool value = true)
+  {
+    m_bits = value ? m_bits | 1ULL << pos : m_bits & ~ (1ULL << pos);
+    return *this;
+  };
+
+  void reset()
+  {
+    m_bits = 0;
+  };
+
+  constexpr uint64_t to_ullong() const
+  {
+    return m_bits;
+  };
+
+  constexpr unsigned long to_ulong() const
+  {
+    return static_cast<unsigned long> (m_bits);
+  };
+
+  constexpr bs_t operator& (const bs_t &bs) const { return bs_t (m_bits & bs.m_bits); };
+  constexpr bs_t operator| (const bs_t &bs) const { return bs_t (m_bits | bs.m_bits); };
+  constexpr bs_t operator^ (const bs_t &bs) const { return bs_t (m_bits ^ bs.m_bits); };
+  constexpr bs_t operator~ () const { return bs_t (~m_bits); };
+  constexpr bs_t operator<< (int n) const { return bs_t (m_bits << n); };
+  constexpr bs_t operator>> (int n) const { return bs_t (m_bits >> n); };
+
+  constexpr bool operator== (const bs_t &bs) const { return m_bits == bs.m_bits; };
+  constexpr bool operator!= (const bs_t &bs) const { return m_bits != bs.m_bits; };
+
+  bs_t &operator&= (const bs_t &bs) { m_bits &= bs.m_bits; return *this; };
+  bs_t &operator|= (const bs_t &bs) { m_bits |= bs.m_bits; return *this; };
+  bs_t &operator^= (const bs_t &bs) { m_bits ^= bs.m_bits; return *this; };
+  bs_t &operator<<= (int n) { m_bits <<= n; return *this; };
+  bs_t &operator>>= (int n) { m_bits >>= n; return *this; };
+
+private:
+  uint64_t m_bits;
+};
 
 /*! Used to XOR with a bit schedule.  Should return true for a valid bit schedule */
-const bs_t MASK_DAY   ("0011111000000000000000000000000000000000000000000000000000000000");
+constexpr bs_t MASK_DAY   (0x3e00000000000000ULL);
 
 /*! Used to XOR with a bit schedule.  Should return true for a valid bit schedule */
-const bs_t MASK_TIME  ("0000000000000000000000111111111111111111111111110000000000000000");
+constexpr bs_t MASK_TIME  (0x000003ffffff0000ULL);
 
 /*! VALID_MASK = ~(MASK_DAY ^ MASK_TIME) */
-const bs_t VALID_MASK ("1100000111111111111111000000000000000000000000001111111111111111");
+constexpr bs_t VALID_MASK (0xc1fffc000000ffffULL);
 
 const std::string COMPILE_TIME = __TIME__;
 const std::string COMPILE_DATE = __DATE__;
@@ -59,6 +181,33 @@ const std::string FILE_HTML   = "html_header.txt";
 const std::string FILE_ROOM   = "rooms.csv";
 const std::string FILE_CONFIG = "sched.cfg";
 
+/*! Parsed problem written and read when SNAPSHOT is COMPILE or LOAD */
+const std::string FILE_SNAPSHOT = "problem.snap";
+
+/*! File names for all output files */
+const std::string FILE_DEBUG     = "debug.log";
+const std::string FILE_FAILED    = "failed.csv";
+const std::string FILE_SCHEDULED = "scheduled.csv";
+const std::string FILE_GROUP_CAL = "group.html";
+const std::string FILE_INSTR_CAL = "instr.html";
+const std::string FILE_ROOM_CAL  = "room.html";
+
+/*! Written after the other output files, once they are complete */
+const std::string FILE_MANIFEST  = "manifest.txt";
+
+/*!
+  Exit status of sacs:
+
+    EXIT_OK:      schedules saved, or the snapshot compiled
+    EXIT_ERROR:   an error was written to debug.log
+    EXIT_USAGE:   invalid command line
+    EXIT_EXISTS:  schedules not saved over existing ones, see OVERWRITE
+*/
+enum e_exit
+{
+  EXIT_OK, EXIT_ERROR, EXIT_USAGE, EXIT_EXISTS
+};
+
 /*! Used for error checking with parsing files */
 const std::string VALID_DAYS = "SUNMONTUEWEDTHUFRISATALL";
 
@@ -137,6 +286,55 @@ private:
   int index;
 };
 
+/*!
+  Symbol table that interns names as dense integers in the order they are first
+  seen, so that indices keyed by name can be kept in flat arrays:
+
+    symtab_t sym;
+
+    sym.intern("WEBER") returns 0
+    sym.intern("SCOTT") returns 1
+    sym.intern("WEBER") returns 0
+    sym.name(1) returns SCOTT
+*/
+class symtab_t
+{
+public:
+  int intern (std::string_view str)
+  {
+    std::map<std::string, int, std::less<> >::iterator it = m_mapstr_sym.find (str);
+
+    if (it != m_mapstr_sym.end() )
+      return it->second;
+
+    m_mapstr_sym.emplace (str, static_cast<int> (m_vec_name.size() ) );
+    m_vec_name.emplace_back (str);
+    return static_cast<int> (m_vec_name.size() ) - 1;
+  };
+
+  /*! Returns -1 if str has not been interned */
+  int find (std::string_view str) const
+  {
+    std::map<std::string, int, std::less<> >::const_iterator it = m_mapstr_sym.find (str);
+    return it == m_mapstr_sym.end() ? -1 : it->second;
+  };
+
+  const std::string &name (int sym) const
+  {
+    assert (sym >= 0 && sym < size() );
+    return m_vec_name[sym];
+  };
+
+  int size() const
+  {
+    return static_cast<int> (m_vec_name.size() );
+  };
+
+private:
+  std::map<std::string, int, std::less<> > m_mapstr_sym;
+  std::vector<std::string> m_vec_name;
+};
+
 /*!
   AVR6 denotes a strong aversions, PRF6 a strong preference, and VOID
   represents a schedule block. OPEN is default.
@@ -149,11 +347,12 @@ enum e_bias
   VOID
 };
 
-/*! Used to store room data */
+/*! Used to store room data, sym is the interned room ID */
 struct room_t
 {
   std::string id;
   int size;
+  int sym;
 };
 
 /*!
@@ -254,9 +453,14 @@ public:
   vector<bs_t> vec_avail_times:
     the times a class can be schedules
 
+  vector<int> vec_bias:
+    the bias score of each entry of vec_avail_times for all instructors,
+    computed once by push_course.  Negative if the time is blocked, either for
+    an instructor or globally.
+
   vector<string> vec_avoid:
     the names of the classes that the course should not be scheduled
-    concurrently with
+    concurrently with, each listed once
 
   vector<string> vec_instr:
     the instructor(s) designated to teach the class
@@ -264,6 +468,11 @@ public:
   vector<room_t> vec_prooms:
     potential rooms available for use depending on if lab or lecture and size
 
+  int name_sym, room_sym:
+  vector<int> vec_avoid_sym, vec_elec_sym, vec_instr_sym:
+    the interned course names, room, and instructors used to look up the
+    universal indices.  room_sym is -1 while no room is assigned.
+
   vector<uint8_t> vec_days:
     used in conjunction with multi_days when multiple optional days are read
     from the CSV
@@ -290,16 +499,22 @@ public:
     lectures     = 0;
     multi_days   = false;
     name         = "";
+    name_sym     = -1;
     room_id      = "";
+    room_sym     = -1;
     size         = 0;
     start_time   = 0.0;
     bs_sched.reset();
     health.init();
     vec_avail_times.clear();
     vec_avoid.clear();
+    vec_avoid_sym.clear();
+    vec_bias.clear();
     vec_days.clear();
     vec_elec.clear();
+    vec_elec_sym.clear();
     vec_instr.clear();
+    vec_instr_sym.clear();
     vec_prooms.clear();
   };
 
@@ -316,9 +531,11 @@ public:
 
   int hours;
   int lectures;
+  int name_sym;
+  int room_sym;
   int size;
 
-  std::bitset<64> bs_sched;
+  bs_t bs_sched;
 
   std::string group;
   std::string id;
@@ -331,17 +548,188 @@ public:
   std::vector<std::string> vec_elec;
   std::vector<std::string> vec_instr;
 
+  std::vector<int> vec_avoid_sym;
+  std::vector<int> vec_bias;
+  std::vector<int> vec_elec_sym;
+  std::vector<int> vec_instr_sym;
+
   std::vector<room_t> vec_prooms;
   std::vector<uint8_t> vec_days;
 
   uint8_t days;
 };
 
-/*! Used to pass schedules to functions */
+/*!
+  The part of a course that changes while annealing.  Course definitions never
+  change and are kept once in Schedule::m_vec_crs.
+
+  time:
+    index of the chosen bit schedule in course_t::vec_avail_times, or -1 if the
+    course has not been scheduled
+
+  room:
+    index of the chosen room in course_t::vec_prooms, or -1 if the room is
+    constant or has not been chosen
+*/
+struct slot_t
+{
+  int time;
+  int room;
+  health_t health;
+};
+
+/*!
+  Used to pass schedules to functions
+
+  vec_order:
+    indices into Schedule::m_vec_crs in the order courses are scheduled
+
+  vec_slot:
+    the schedule of each course, indexed the same as Schedule::m_vec_crs
+
+  vec_pos:
+    the position of each course in vec_order
+
+  vec_room_crs:
+    the scheduled courses in each room, indexed by interned room.  Only kept
+    up to date for accepted states, see Schedule::local_move.
+*/
 struct state_t
 {
   health_t health;
-  std::vector<course_t> vec_crs;
+  std::vector<int> vec_order;
+  std::vector<int> vec_pos;
+  std::vector<slot_t> vec_slot;
+  std::vector<std::vector<int> > vec_room_crs;
+};
+
+/*!
+  Universal indices used to track what has already been scheduled.  To update
+  the indices, elements are simply bitwise ORed ontop of whatever else is there.
+  The indices are flat arrays using the interned names of courses, instructors,
+  and rooms.
+
+    crs[course.name_sym] |= bit schedule
+*/
+struct uidx_t
+{
+  void resize (int crs_count, int instr_count, int room_count)
+  {
+    crs.assign (crs_count, bs_t() );
+    instr.assign (instr_count, bs_t() );
+    room.assign (room_count, bs_t() );
+  };
+
+  void push (const course_t &course, const bs_t &bs, int room_sym)
+  {
+    crs[course.name_sym] |= bs;
+
+    if (room_sym >= 0)
+      room[room_sym] |= bs;
+
+    for (auto it = course.vec_instr_sym.begin(); it != course.vec_instr_sym.end(); it++)
+      instr[*it] |= bs;
+  };
+
+  void push (const course_t &course)
+  {
+    push (course, course.bs_sched, course.room_sym);
+  };
+
+  std::vector<bs_t> crs;
+  std::vector<bs_t> instr;
+  std::vector<bs_t> room;
+};
+
+/*!
+  Checkpoints of the universal indices taken while a state is scheduled in
+  order.  Courses before the first swapped position are scheduled exactly as
+  before, so a perturbed state only needs to be rescheduled from there.
+
+  vec_uidx[k] and vec_health[k] hold the indices and summed health of the
+  accepted state before position k * stride is scheduled.  The vec_next
+  vectors are filled in for the proposed state and swapped in on acceptance.
+  uidx is scratch space so that iterations do not allocate.
+
+  first:
+    the first position rescheduled for the proposed state
+
+  retake:
+    the first checkpoint retaken for the proposed state
+
+  stale:
+    the first position changed in place by Schedule::local_move since the
+    checkpoints after it were taken, INF if none
+
+  valid:
+    false until a state has been accepted
+*/
+struct chkpt_t
+{
+  chkpt_t() : first (0), retake (0), stale (INF), stride (1), valid (false) {};
+
+  int first;
+  int retake;
+  int stale;
+  int stride;
+  bool valid;
+
+  std::vector<health_t> vec_health;
+  std::vector<health_t> vec_next_health;
+
+  std::vector<uidx_t> vec_uidx;
+  std::vector<uidx_t> vec_next_uidx;
+
+  uidx_t uidx;
+};
+
+/*!
+  Moves used to perturb a state, drawn with the weights of the MOVE-* options:
+
+    MOVE_SWAP:   two courses swap positions in the order
+    MOVE_FRONT:  a course that cannot be scheduled is moved to the front
+    MOVE_TIME:   a course is given another of its times
+    MOVE_ROOM:   a course is given another of its rooms
+    MOVE_KEMPE:  a course and the chain of courses it conflicts with in its
+                 time and that of a conflicting course swap the two times
+
+  MOVE_SWAP and MOVE_FRONT reschedule the state from the first position moved,
+  the others change slots in place, see Schedule::local_move.
+*/
+enum e_move
+{
+  MOVE_SWAP, MOVE_FRONT, MOVE_TIME, MOVE_ROOM, MOVE_KEMPE, MOVES
+};
+
+/*!
+  A single Markov chain.  Each chain has its own random number generator and
+  scratch space so that chains can be annealed on separate threads.
+
+  state:
+    the accepted state
+
+  cur_state:
+    the proposed state filled in by perturb_state
+
+  seed:
+    the seed rng was started with
+
+  accepts:
+    the number of perturbed states accepted so far
+
+  move_tries, move_accepts:
+    the number of states proposed and accepted by each move
+*/
+struct chain_t
+{
+  chkpt_t chkpt;
+  prng_t rng;
+  state_t cur_state;
+  state_t state;
+  uint32_t seed;
+  int accepts;
+  int move_tries[MOVES];
+  int move_accepts[MOVES];
 };
 
 /*! Used to sort candidate schedules for individual courses */
@@ -483,9 +871,19 @@ const std::string sched_hex_idx[6][35] =
 */
 void util_init            ();
 
+/*! Sets prog_opts to the defaults used when sched.cfg does not override them */
+void opts_init            ();
+
 /*! Determine if file exists */
 bool file_exists          (const char *file);
 
+/*!
+  Paths of input and output files, in INPUT-DIR and OUTPUT-DIR, or the
+  current directory if they are empty
+*/
+std::string input_path    (const std::string &file);
+std::string output_path   (const std::string &file);
+
 /*!
   token_count("", ":") returns 0
   token_count("a", ":") returns 1
@@ -501,9 +899,36 @@ int token_count           (const std::string &str, std::string tok);
 */
 std::string get_token     (const std::string &str, int n, std::string delim);
 
+/*!
+  Splits str at every delim in one pass, replacing the contents of vec_tok.
+  Gives the same tokens as get_token, token_count of them:
+
+  split("a:b:", ':', vec_tok) gives a, b, and an empty token
+  split("", ':', vec_tok) gives none
+
+  Tokens are views into str, which must outlive them.
+*/
+void split                (std::string_view str, char delim, std::vector<std::string_view> &vec_tok);
+
+/*! Returns token n of vec_tok, or an empty token if there are not that many */
+inline std::string_view get_field (const std::vector<std::string_view> &vec_tok, size_t n)
+{
+  return n < vec_tok.size() ? vec_tok[n] : std::string_view();
+}
+
+/*! atoi and atof for tokens given by split */
+int field_to_int          (std::string_view field);
+double field_to_double    (std::string_view field);
+
 /*! Convert lower case characters of string to upper case */
 std::string make_upper    (const std::string &str);
 
+/*!
+  Same as above without copying str unless it has lower case characters, in
+  which case the upper case copy is made in buf.  The result views str or buf.
+*/
+std::string_view make_upper (std::string_view str, std::string &buf);
+
 /*!
   Creates string from vector of strings of instructors and appends "<br>"
   between for HTML output.
@@ -540,9 +965,6 @@ std::string flag_to_str   (uint8_t days);
 /*! Parses vector of string into single string delimited with a colon */
 std::string vec_to_str    (const std::vector<std::string> &vec_instr);
 
-/*! Converts hex character to bit string */
-std::string hex_to_bin    (char hex);
-
 /*! Stores program options */
 extern std::map<std::string, std::string> prog_opts;
 
@@ -630,12 +1052,7 @@ inline double get_score (const health_t &health, size_t s)
 inline int get_firstbitpos (const bs_t &bs)
 {
   assert (bs.any() );
-
-  for (int i = 0; i < 47; i++)
-    if (bs[i])
-      return i;
-
-  return 47;
+  return std::min (trailing_zeros (bs.to_ullong() ), 47);
 }
 
 #endif // !defined(UTILITY_HPP)